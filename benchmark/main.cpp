@@ -0,0 +1,404 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+
+static const size_t shader_count = 1000;
+static const size_t shader_words = 1024;
+static const size_t iterations = 100000;
+
+static std::string shader_name(size_t index);
+static std::vector<uint32_t> shader_code(size_t index);
+static void measure(const std::string &name, size_t count, const std::function<void(size_t)> &body);
+
+// repository benchmarks
+namespace repository
+{
+    static void load();
+    static void query();
+    static void concurrent_load();
+    static void preloaded_load();
+}
+
+// compiler benchmarks
+namespace compiler
+{
+    static void cached();
+}
+
+// registry benchmarks
+namespace registry
+{
+    static void load();
+}
+
+// backend benchmarks, one suite run against each repository format
+namespace backend
+{
+    static void sqlite();
+    static void memory();
+    static void pack();
+}
+
+// encoding benchmarks
+namespace encoding
+{
+    static void decode();
+}
+
+// reference benchmarks, matching the repository before statements were cached
+namespace reference
+{
+    static void load();
+    static void query();
+}
+
+#define BENCHMARK_CASE(NAME) {#NAME, NAME}
+
+int main(int argc, const char **argv)
+{
+    const std::map<std::string, std::function<void()>> benchmark_cases = {
+        BENCHMARK_CASE(repository::load),
+        BENCHMARK_CASE(repository::query),
+        BENCHMARK_CASE(repository::concurrent_load),
+        BENCHMARK_CASE(repository::preloaded_load),
+        BENCHMARK_CASE(compiler::cached),
+        BENCHMARK_CASE(registry::load),
+        BENCHMARK_CASE(backend::sqlite),
+        BENCHMARK_CASE(backend::memory),
+        BENCHMARK_CASE(backend::pack),
+        BENCHMARK_CASE(encoding::decode),
+        BENCHMARK_CASE(reference::load),
+        BENCHMARK_CASE(reference::query),
+    };
+    if (argc > 1)
+    {
+        benchmark_cases.at(argv[1])();
+    }
+    else
+    {
+        for (const auto &benchmark_case : benchmark_cases)
+        {
+            benchmark_case.second();
+        }
+    }
+    return 0;
+}
+
+std::string shader_name(size_t index)
+{
+    return "shader_" + std::to_string(index);
+}
+
+std::vector<uint32_t> shader_code(size_t index)
+{
+    std::mt19937 generator(static_cast<uint32_t>(index));
+    std::vector<uint32_t> code(shader_words);
+    for (uint32_t &word : code)
+    {
+        word = generator();
+    }
+    return code;
+}
+
+void measure(const std::string &name, size_t count, const std::function<void(size_t)> &body)
+{
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t index = 0; index < count; index++)
+    {
+        body(index);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double nanoseconds = std::chrono::duration<double, std::nano>(end - begin).count();
+    std::cout << name << ": " << count << " iterations, " << nanoseconds / count << " ns/op" << std::endl;
+}
+
+static std::unique_ptr<vsm::repository> populate_repository(const std::string &path = "", bool shared = false, VsmRepositoryFormat format = VSM_REPOSITORY_FORMAT_SQLITE)
+{
+    std::unique_ptr<vsm::repository> result = vsm::repository::create(format, path, shared, VSM_CODE_ENCODING_RAW, false);
+    for (size_t index = 0; index < shader_count; index++)
+    {
+        result->store(shader_name(index), VSM_SHADER_COMPUTE, vsm::digest{}, shader_code(index), {});
+    }
+    return result;
+}
+
+static std::vector<std::string> shuffled_names()
+{
+    std::vector<std::string> result;
+    for (size_t index = 0; index < shader_count; index++)
+    {
+        result.push_back(shader_name(index));
+    }
+    std::shuffle(result.begin(), result.end(), std::mt19937(0));
+    return result;
+}
+
+void repository::load()
+{
+    std::unique_ptr<vsm::repository> repository = populate_repository();
+    const std::vector<std::string> names = shuffled_names();
+    std::vector<uint32_t> code;
+    measure("repository::load", iterations, [&](size_t index)
+            { repository->load(names[index % names.size()], code); });
+}
+
+void repository::query()
+{
+    std::unique_ptr<vsm::repository> repository = populate_repository();
+    const std::vector<std::string> names = shuffled_names();
+    measure("repository::query", iterations, [&](size_t index)
+            { static_cast<void>(repository->query(names[index % names.size()])); });
+}
+
+void repository::concurrent_load()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_benchmark.db").string();
+    const std::vector<std::string> names = shuffled_names();
+    const size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::filesystem::remove(path);
+    {
+        std::unique_ptr<vsm::repository> repository = populate_repository(path, true);
+        for (size_t thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+        {
+            std::vector<std::thread> threads;
+            const auto begin = std::chrono::steady_clock::now();
+            for (size_t thread = 0; thread < thread_count; thread++)
+            {
+                threads.emplace_back([&, thread]()
+                                     {
+                                         std::vector<uint32_t> code;
+                                         for (size_t index = 0; index < iterations / 10; index++)
+                                         {
+                                             repository->load(names[(index + thread * 7) % names.size()], code);
+                                         } });
+            }
+            for (std::thread &thread : threads)
+            {
+                thread.join();
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            std::cout << "repository::concurrent_load: " << thread_count << " threads, "
+                      << thread_count * (iterations / 10) / seconds << " loads/s" << std::endl;
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+void repository::preloaded_load()
+{
+    std::unique_ptr<vsm::repository> repository = populate_repository();
+    const std::vector<std::string> names = shuffled_names();
+    std::vector<uint32_t> code;
+    measure("repository::preload", 1, [&](size_t index)
+            { repository->preload(); });
+    measure("repository::preloaded_load", iterations, [&](size_t index)
+            { repository->load(names[index % names.size()], code); });
+}
+
+void compiler::cached()
+{
+    static const std::string source =
+        "#version 430\n"
+        "void main(){\n"
+        "}\n";
+    const VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    const VsmShaderCompileInfo compile_info = {
+        "cached",
+        source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmContext context;
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+    measure("compiler::cached", iterations, [&](size_t index)
+            { static_cast<void>(vsmCompileShader(context, &compile_info)); });
+    vsmDestroyContext(context, nullptr);
+}
+
+void registry::load()
+{
+    std::unique_ptr<vsm::repository> repository = populate_repository();
+    const std::vector<std::string> names = shuffled_names();
+    vsm::registry registry;
+    std::vector<VsmShader> shaders;
+    for (const std::string &name : names)
+    {
+        shaders.push_back(registry.get(name));
+    }
+    measure("registry::load", iterations, [&](size_t index)
+            { static_cast<void>(registry.load(shaders[index % shaders.size()], *repository)); });
+}
+
+static void backend_suite(const std::string &name, vsm::repository &repository)
+{
+    const std::vector<std::string> names = shuffled_names();
+    std::vector<uint32_t> code;
+    measure(name + "::load", iterations, [&](size_t index)
+            { repository.load(names[index % names.size()], code); });
+    measure(name + "::query", iterations, [&](size_t index)
+            { static_cast<void>(repository.query(names[index % names.size()])); });
+    measure(name + "::cached", iterations, [&](size_t index)
+            { static_cast<void>(repository.cached(names[index % names.size()], vsm::digest{})); });
+}
+
+static void backend_store(const std::string &name, VsmRepositoryFormat format)
+{
+    std::unique_ptr<vsm::repository> repository = vsm::repository::create(format, "", false, VSM_CODE_ENCODING_RAW, false);
+    const std::vector<uint32_t> code = shader_code(0);
+    measure(name + "::store", iterations / 10, [&](size_t index)
+            { repository->store(shader_name(index % shader_count), VSM_SHADER_COMPUTE, vsm::digest{}, code, {}); });
+}
+
+void backend::sqlite()
+{
+    backend_store("backend::sqlite", VSM_REPOSITORY_FORMAT_SQLITE);
+    backend_suite("backend::sqlite", *populate_repository("", false, VSM_REPOSITORY_FORMAT_SQLITE));
+}
+
+void backend::memory()
+{
+    backend_store("backend::memory", VSM_REPOSITORY_FORMAT_MEMORY);
+    backend_suite("backend::memory", *populate_repository("", false, VSM_REPOSITORY_FORMAT_MEMORY));
+}
+
+void backend::pack()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_benchmark.pack").string();
+    populate_repository("", false, VSM_REPOSITORY_FORMAT_MEMORY)->export_pack(path);
+    measure("backend::pack::open", iterations / 100, [&](size_t index)
+            { vsm::repository::create(VSM_REPOSITORY_FORMAT_PACK, path, false, VSM_CODE_ENCODING_RAW, false); });
+    backend_suite("backend::pack", *vsm::repository::create(VSM_REPOSITORY_FORMAT_PACK, path, false, VSM_CODE_ENCODING_RAW, false));
+    std::filesystem::remove(path);
+}
+
+void encoding::decode()
+{
+    // a representative fragment shader, so the ratio reflects real SPIR-V
+    static const std::string source =
+        "#version 450\n"
+        "layout(set = 0, binding = 0) uniform Material { vec4 albedo; vec4 params; mat4 transforms[4]; } material;\n"
+        "layout(set = 0, binding = 1) uniform sampler2D textures[4];\n"
+        "layout(location = 0) in vec3 normal;\n"
+        "layout(location = 1) in vec2 uv;\n"
+        "layout(location = 0) out vec4 color;\n"
+        "vec3 shade(vec3 n, vec3 l, vec3 albedo) { return albedo * max(dot(n, l), 0.0); }\n"
+        "void main() {\n"
+        "    vec3 result = vec3(0.0);\n"
+        "    for (int i = 0; i < 4; i++) {\n"
+        "        vec4 light = material.transforms[i] * vec4(normalize(normal), 0.0);\n"
+        "        vec3 albedo = texture(textures[i], uv * material.params.xy).rgb * material.albedo.rgb;\n"
+        "        result += shade(normalize(normal), normalize(light.xyz), albedo);\n"
+        "    }\n"
+        "    color = vec4(pow(result, vec3(1.0 / 2.2)), material.albedo.a);\n"
+        "}\n";
+    vsm::compiler compiler(VSM_VULKAN_1_2, VSM_SPV_1_5);
+    std::vector<uint32_t> code;
+    std::vector<uint32_t> reflection;
+    std::vector<vsm::dependency> dependencies;
+    compiler.compile({"decode", VSM_SHADER_FRAGMENT, std::string(), source}, code, reflection, dependencies);
+    const double megabytes = code.size() * sizeof(uint32_t) / (1024.0 * 1024.0);
+    for (VsmCodeEncoding encoding : {VSM_CODE_ENCODING_VARINT, VSM_CODE_ENCODING_COMPACT})
+    {
+        const std::string name = encoding == VSM_CODE_ENCODING_VARINT ? "encoding::decode(varint)" : "encoding::decode(compact)";
+        std::vector<uint8_t> encoded;
+        std::vector<uint32_t> decoded;
+        vsm::encoding::encode(encoding, code, encoded);
+        const auto begin = std::chrono::steady_clock::now();
+        measure(name, iterations, [&](size_t index)
+                { vsm::encoding::decode(encoded.data(), encoded.size(), decoded); });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": ratio " << static_cast<double>(code.size() * sizeof(uint32_t)) / encoded.size()
+                  << ", " << megabytes * iterations / seconds << " MB/s" << std::endl;
+    }
+}
+
+static std::unique_ptr<sqlite3, decltype(&sqlite3_close)> populate_reference()
+{
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    sqlite3_open_v2(":memory:", &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+    sqlite3_exec(db, "CREATE TABLE shaders (name TEXT NOT NULL, stage INTEGER NOT NULL, code BLOB NOT NULL);"
+                     "CREATE UNIQUE INDEX shader_index ON shaders(name);",
+                 nullptr, nullptr, nullptr);
+    sqlite3_prepare_v2(db, "INSERT INTO shaders (name, stage, code) VALUES (?, ?, ?);", -1, &stmt, nullptr);
+    for (size_t index = 0; index < shader_count; index++)
+    {
+        const std::string name = shader_name(index);
+        const std::vector<uint32_t> code = shader_code(index);
+        sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, VSM_SHADER_COMPUTE);
+        sqlite3_bind_blob(stmt, 3, code.data(), code.size() * sizeof(uint32_t), SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(db, sqlite3_close);
+}
+
+void reference::load()
+{
+    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> db = populate_reference();
+    const std::vector<std::string> names = shuffled_names();
+    static const std::string sql = "SELECT code FROM shaders WHERE name = ?;";
+    std::vector<uint32_t> code;
+    measure("reference::load", iterations, [&](size_t index)
+            {
+                const std::string &name = names[index % names.size()];
+                sqlite3_stmt *stmt;
+                sqlite3_prepare_v2(db.get(), sql.c_str(), sql.size(), &stmt, nullptr);
+                sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC);
+                sqlite3_step(stmt);
+                code.resize(sqlite3_column_bytes(stmt, 0) / sizeof(uint32_t));
+                memcpy(code.data(), sqlite3_column_blob(stmt, 0), code.size() * sizeof(uint32_t));
+                sqlite3_finalize(stmt); });
+}
+
+void reference::query()
+{
+    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> db = populate_reference();
+    const std::vector<std::string> names = shuffled_names();
+    static const std::string sql = "SELECT stage FROM shaders WHERE name = ?;";
+    measure("reference::query", iterations, [&](size_t index)
+            {
+                const std::string &name = names[index % names.size()];
+                sqlite3_stmt *stmt;
+                sqlite3_prepare_v2(db.get(), sql.c_str(), sql.size(), &stmt, nullptr);
+                sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC);
+                sqlite3_step(stmt);
+                static_cast<void>(sqlite3_column_int(stmt, 0));
+                sqlite3_finalize(stmt); });
+}
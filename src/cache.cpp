@@ -0,0 +1,119 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::cache::cache(size_t budget) : _budget(budget), _size(0), _generation(0), _statistics{}
+{
+}
+
+bool vsm::cache::enabled() const
+{
+    return _budget > 0;
+}
+
+void vsm::cache::erase(std::list<entry>::iterator position)
+{
+    _size -= position->code->size() * sizeof(uint32_t);
+    _index.erase(position->name);
+    _entries.erase(position);
+}
+
+vsm::cache::shared_code vsm::cache::find(const std::string &name, uint64_t &generation)
+{
+    shared_code result;
+    if (enabled())
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto position = _index.find(name);
+        if (position != _index.end())
+        {
+            _entries.splice(_entries.begin(), _entries, position->second);
+            result = position->second->code;
+            _statistics.hits++;
+        }
+        else
+        {
+            _statistics.misses++;
+        }
+        generation = _generation;
+    }
+    return result;
+}
+
+void vsm::cache::insert(const std::string &name, shared_code code, uint64_t generation)
+{
+    const size_t size = code->size() * sizeof(uint32_t);
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!enabled() || size > _budget || generation != _generation)
+    {
+        return;
+    }
+    const auto position = _index.find(name);
+    if (position != _index.end())
+    {
+        erase(position->second);
+    }
+    while (_size + size > _budget)
+    {
+        erase(std::prev(_entries.end()));
+        _statistics.evictions++;
+    }
+    _entries.push_front({name, std::move(code)});
+    _index.emplace(name, _entries.begin());
+    _size += size;
+}
+
+void vsm::cache::invalidate(const std::string &name)
+{
+    if (enabled())
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto position = _index.find(name);
+        if (position != _index.end())
+        {
+            erase(position->second);
+        }
+        _generation++;
+    }
+}
+
+void vsm::cache::clear()
+{
+    if (enabled())
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+        _index.clear();
+        _size = 0;
+        _generation++;
+    }
+}
+
+VsmCacheStatistics vsm::cache::statistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    VsmCacheStatistics result = _statistics;
+    result.entryCount = static_cast<uint32_t>(_entries.size());
+    result.size = _size;
+    return result;
+}
@@ -22,6 +22,10 @@
 
 #include "internal.hpp"
 
+// glslang's process state is shared by every compiler, so it lives while any compiler does
+static std::mutex process_mutex;
+static size_t process_references = 0;
+
 void vsm::glsl_preprocess(std::unique_ptr<glslang_shader_t, decltype(&glslang_shader_delete)> &shader, const glslang_input_t *input)
 {
     if (!glslang_shader_preprocess(shader.get(), input))
@@ -46,7 +50,7 @@ void vsm::glsl_link(std::unique_ptr<glslang_program_t, decltype(&glslang_program
     }
 }
 
-vsm::compiler::compiler(VsmVulkanVersion vk_version, VsmSPVVersion spv_version)
+vsm::compiler::compiler(VsmVulkanVersion vk_version, VsmSPVVersion spv_version, std::unique_ptr<includer> includer) : _includer(std::move(includer))
 {
     static const std::unordered_map<VsmVulkanVersion, glslang_target_client_version_t> vk_version_map = {
         {VSM_VULKAN_1_0, GLSLANG_TARGET_VULKAN_1_0},
@@ -76,9 +80,88 @@ vsm::compiler::compiler(VsmVulkanVersion vk_version, VsmSPVVersion spv_version)
 
     _vk_version = vk_version_map.at(vk_version);
     _spv_version = spv_version_map.at(spv_version);
+    // the optimizer targets the same environment glslang compiled for
+    switch (vk_version)
+    {
+    case VSM_VULKAN_1_0:
+        _environment = SPV_ENV_VULKAN_1_0;
+        break;
+    case VSM_VULKAN_1_1:
+        _environment = spv_version >= VSM_SPV_1_4 ? SPV_ENV_VULKAN_1_1_SPIRV_1_4 : SPV_ENV_VULKAN_1_1;
+        break;
+    case VSM_VULKAN_1_2:
+        _environment = SPV_ENV_VULKAN_1_2;
+        break;
+    default:
+        _environment = SPV_ENV_VULKAN_1_3;
+        break;
+    }
+
+    std::lock_guard<std::mutex> lock(process_mutex);
+    // the count only grows once glslang is initialized, so a failed context leaves no reference behind
+    if (process_references == 0 && !glslang_initialize_process())
+    {
+        throw exception(VSM_ERROR_COMPILER_INIT);
+    }
+    process_references++;
+}
+
+vsm::compiler::~compiler()
+{
+    std::lock_guard<std::mutex> lock(process_mutex);
+    if (--process_references == 0)
+    {
+        glslang_finalize_process();
+    }
+}
+
+std::string vsm::compiler::preamble(const compile_request &request) const
+{
+    // glslang only resolves #include through the callbacks once the extension is enabled
+    if (_includer != nullptr)
+    {
+        return "#extension GL_GOOGLE_include_directive : enable\n" + request.preamble;
+    }
+    return request.preamble;
 }
 
-void vsm::compiler::compile(const std::string &name, VsmShaderStage stage, const std::string &source, std::vector<uint32_t> &code)
+vsm::digest vsm::compiler::key(const compile_request &request) const
+{
+    const std::string preamble = this->preamble(request);
+    const uint32_t options[] = {
+        static_cast<uint32_t>(request.stage),
+        static_cast<uint32_t>(_vk_version),
+        static_cast<uint32_t>(_spv_version),
+        GLSLANG_VERSION_MAJOR,
+        GLSLANG_VERSION_MINOR,
+        GLSLANG_VERSION_PATCH,
+    };
+    // each text is preceded by its size, so text moved between fields changes the key
+    const uint64_t sizes[] = {
+        preamble.size(),
+        request.optimization.passes.size(),
+        request.source.size(),
+    };
+    vsm::sha256 key;
+    key.update(options, sizeof(options));
+    key.update(sizes, sizeof(sizes));
+    key.update(preamble.data(), preamble.size());
+    key.update(request.optimization.passes.data(), request.optimization.passes.size());
+    key.update(request.source.data(), request.source.size());
+    return key.finish();
+}
+
+bool vsm::compiler::includes(const std::string &source) const
+{
+    return source.find("#include") != std::string::npos;
+}
+
+bool vsm::compiler::hash_header(const std::string &name, uint64_t &hash)
+{
+    return _includer != nullptr && _includer->hash(name, hash);
+}
+
+void vsm::compiler::compile(const compile_request &request, std::vector<uint32_t> &code, std::vector<uint32_t> &reflection, std::vector<dependency> &dependencies)
 {
     static const std::unordered_map<VsmShaderStage, glslang_stage_t> stage_map = {
         {VSM_SHADER_VERTEX, GLSLANG_STAGE_VERTEX},
@@ -97,36 +180,62 @@ void vsm::compiler::compile(const std::string &name, VsmShaderStage stage, const
         {VSM_SHADER_MESH, GLSLANG_STAGE_MESH},
     };
 
-    if (stage_map.find(stage) == stage_map.end())
+    if (stage_map.find(request.stage) == stage_map.end())
     {
         throw exception(VSM_ERROR_SHADER_STAGE);
     }
 
+    std::unique_ptr<includer::session> session(_includer != nullptr ? new includer::session{*_includer, {}} : nullptr);
     const glslang_input_t input = {
         GLSLANG_SOURCE_GLSL,
-        stage_map.at(stage),
+        stage_map.at(request.stage),
         GLSLANG_CLIENT_VULKAN,
         _vk_version,
         GLSLANG_TARGET_SPV,
         _spv_version,
-        source.c_str(),
+        request.source.c_str(),
         100,
         GLSLANG_NO_PROFILE,
         false,
         false,
         GLSLANG_MSG_DEFAULT_BIT,
         glslang_default_resource(),
+        _includer != nullptr ? includer::callbacks() : glsl_include_callbacks_t{},
+        session.get(),
     };
 
     std::unique_ptr<glslang_shader_t, decltype(&glslang_shader_delete)> shader(glslang_shader_create(&input), glslang_shader_delete);
     std::unique_ptr<glslang_program_t, decltype(&glslang_program_delete)> program(glslang_program_create(), glslang_program_delete);
+    const std::string preamble = this->preamble(request);
+    if (!preamble.empty())
+    {
+        glslang_shader_set_preamble(shader.get(), preamble.c_str());
+    }
 
-    //glslang_initialize_process();
+    // once the process is initialized, each compile only touches its own shader and program
     vsm::glsl_preprocess(shader, &input);
     vsm::glsl_parse(shader, &input);
     glslang_program_add_shader(program.get(), shader.get());
     vsm::glsl_link(program, GLSLANG_MSG_SPV_RULES_BIT | GLSLANG_MSG_VULKAN_RULES_BIT);
-    glslang_program_SPIRV_generate(program.get(), stage_map.at(stage));
+    glslang_program_SPIRV_generate(program.get(), stage_map.at(request.stage));
     code.resize(glslang_program_SPIRV_get_size(program.get()));
     glslang_program_SPIRV_get(program.get(), code.data());
-}
\ No newline at end of file
+    if (!request.optimization.tiered)
+    {
+        optimize(request, code);
+    }
+    vsm::reflection::reflect(code, reflection);
+    dependencies.clear();
+    if (session != nullptr)
+    {
+        dependencies = std::move(session->dependencies);
+    }
+}
+
+void vsm::compiler::optimize(const compile_request &request, std::vector<uint32_t> &code) const
+{
+    if (!request.optimization.passes.empty())
+    {
+        optimizer::run(_environment, request.name, request.optimization, code);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+namespace
+{
+    const uint32_t spirv_magic = 0x07230203;
+    const size_t spirv_header_words = 5;
+
+    bool is_debug(uint32_t opcode, bool non_semantic)
+    {
+        switch (opcode)
+        {
+        case 2:   // OpSourceContinued
+        case 3:   // OpSource
+        case 4:   // OpSourceExtension
+        case 5:   // OpName
+        case 6:   // OpMemberName
+        case 8:   // OpLine
+        case 317: // OpNoLine
+        case 330: // OpModuleProcessed
+            return true;
+        // non-semantic debug info refers to strings by id, so they stay when it is imported
+        case 7: // OpString
+            return !non_semantic;
+        default:
+            return false;
+        }
+    }
+
+    // whether the module imports a NonSemantic instruction set, or is not well formed SPIR-V
+    bool scan(const std::vector<uint32_t> &code, bool &non_semantic)
+    {
+        static const char prefix[] = "NonSemantic.";
+        non_semantic = false;
+        if (code.size() < spirv_header_words || code[0] != spirv_magic)
+        {
+            return false;
+        }
+        for (size_t offset = spirv_header_words; offset < code.size();)
+        {
+            const uint32_t word_count = code[offset] >> 16;
+            if (word_count == 0 || word_count > code.size() - offset)
+            {
+                return false;
+            }
+            // OpExtInstImport, whose name starts at its third word
+            if ((code[offset] & 0xFFFF) == 11 && word_count > 2 &&
+                strncmp(reinterpret_cast<const char *>(&code[offset + 2]), prefix, std::min<size_t>(sizeof(prefix) - 1, (word_count - 2) * sizeof(uint32_t))) == 0)
+            {
+                non_semantic = true;
+            }
+            offset += word_count;
+        }
+        return true;
+    }
+}
+
+void vsm::debug_info::strip(const std::vector<uint32_t> &code, std::vector<uint32_t> &stripped, std::vector<uint32_t> &debug)
+{
+    bool non_semantic;
+    stripped.clear();
+    debug.clear();
+
+    // anything that is not SPIR-V is kept whole, so it loads exactly as it was stored
+    if (!scan(code, non_semantic))
+    {
+        stripped = code;
+        return;
+    }
+
+    stripped.reserve(code.size());
+    stripped.insert(stripped.end(), code.begin(), code.begin() + spirv_header_words);
+    for (size_t offset = spirv_header_words; offset < code.size();)
+    {
+        const uint32_t word_count = code[offset] >> 16;
+        std::vector<uint32_t> &output = is_debug(code[offset] & 0xFFFF, non_semantic) ? debug : stripped;
+        // each debug instruction follows the offset in the stripped code it is put back at
+        if (&output == &debug)
+        {
+            debug.push_back(static_cast<uint32_t>(stripped.size()));
+        }
+        output.insert(output.end(), code.begin() + offset, code.begin() + offset + word_count);
+        offset += word_count;
+    }
+}
+
+void vsm::debug_info::merge(const uint32_t *stripped, size_t size, const uint32_t *debug, size_t debug_size, std::vector<uint32_t> &code)
+{
+    size_t position = 0;
+    code.clear();
+    code.reserve(size + debug_size);
+
+    for (size_t offset = 0; offset < debug_size;)
+    {
+        if (debug_size - offset < 2)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+        const size_t insert = debug[offset];
+        const uint32_t word_count = debug[offset + 1] >> 16;
+        if (insert < position || insert > size || word_count == 0 || word_count > debug_size - offset - 1)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+        code.insert(code.end(), stripped + position, stripped + insert);
+        code.insert(code.end(), debug + offset + 1, debug + offset + 1 + word_count);
+        position = insert;
+        offset += word_count + 1;
+    }
+    code.insert(code.end(), stripped + position, stripped + size);
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+namespace
+{
+    // 'VSMC', which cannot be mistaken for the SPIR-V magic number
+    const uint32_t encoded_magic = 0x434D5356;
+    const uint32_t spirv_magic = 0x07230203;
+    const size_t spirv_header_words = 5;
+    // opcodes with 15 or more words store their word count separately
+    const uint32_t inline_word_count_limit = 15;
+
+    enum class operand_kind
+    {
+        literal,
+        relative,
+        raw,
+    };
+
+    struct instruction_traits
+    {
+        bool type;
+        bool result;
+        operand_kind operands;
+    };
+
+    // how each opcode is packed, which only affects the ratio, never correctness
+    instruction_traits get_traits(uint32_t opcode)
+    {
+        switch (opcode)
+        {
+        // debug and module strings are stored verbatim
+        case 2:   // OpSourceContinued
+        case 3:   // OpSource
+        case 4:   // OpSourceExtension
+        case 5:   // OpName
+        case 6:   // OpMemberName
+        case 10:  // OpExtension
+        case 15:  // OpEntryPoint
+        case 330: // OpModuleProcessed
+            return {false, false, operand_kind::raw};
+        case 7:  // OpString
+        case 11: // OpExtInstImport
+            return {false, true, operand_kind::raw};
+        // small enumerants and ids that are defined far from their use
+        case 0:   // OpNop
+        case 8:   // OpLine
+        case 14:  // OpMemoryModel
+        case 16:  // OpExecutionMode
+        case 17:  // OpCapability
+        case 71:  // OpDecorate
+        case 72:  // OpMemberDecorate
+        case 74:  // OpGroupDecorate
+        case 75:  // OpGroupMemberDecorate
+        case 317: // OpNoLine
+        case 331: // OpExecutionModeId
+        case 332: // OpDecorateId
+            return {false, false, operand_kind::literal};
+        case 73: // OpDecorationGroup
+            return {false, true, operand_kind::literal};
+        // control flow and memory operations without a result
+        case 56:  // OpFunctionEnd
+        case 62:  // OpStore
+        case 63:  // OpCopyMemory
+        case 64:  // OpCopyMemorySized
+        case 218: // OpEmitVertex
+        case 219: // OpEndPrimitive
+        case 220: // OpEmitStreamVertex
+        case 221: // OpEndStreamPrimitive
+        case 224: // OpControlBarrier
+        case 225: // OpMemoryBarrier
+        case 246: // OpLoopMerge
+        case 247: // OpSelectionMerge
+        case 249: // OpBranch
+        case 250: // OpBranchConditional
+        case 251: // OpSwitch
+        case 252: // OpKill
+        case 253: // OpReturn
+        case 254: // OpReturnValue
+        case 255: // OpUnreachable
+            return {false, false, operand_kind::relative};
+        case 248: // OpLabel
+            return {false, true, operand_kind::relative};
+        // constants and variables carry literals after the result
+        case 43: // OpConstant
+        case 50: // OpSpecConstant
+        case 59: // OpVariable
+            return {true, true, operand_kind::literal};
+        default:
+            // OpTypeVoid through OpTypeForwardPointer
+            if (opcode >= 19 && opcode <= 39)
+            {
+                return {false, true, operand_kind::literal};
+            }
+            return {true, true, operand_kind::relative};
+        }
+    }
+
+    uint32_t zigzag(uint32_t value)
+    {
+        return (value << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(value) >> 31);
+    }
+
+    uint32_t unzigzag(uint32_t value)
+    {
+        return (value >> 1) ^ (0 - (value & 1));
+    }
+
+    void write_varint(std::vector<uint8_t> &output, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    void write_raw(std::vector<uint8_t> &output, uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            output.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    class reader
+    {
+    private:
+        const uint8_t *_position;
+        const uint8_t *_end;
+    public:
+        reader(const uint8_t *data, size_t size) : _position(data), _end(data + size) {}
+
+        bool empty() const { return _position == _end; }
+
+        uint32_t varint()
+        {
+            uint32_t result = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                if (_position == _end)
+                {
+                    throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+                }
+                const uint8_t byte = *_position++;
+                result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return result;
+                }
+            }
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+
+        uint32_t raw()
+        {
+            uint32_t result = 0;
+            if (_end - _position < 4)
+            {
+                throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+            }
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                result |= static_cast<uint32_t>(*_position++) << shift;
+            }
+            return result;
+        }
+
+        uint8_t byte()
+        {
+            if (_position == _end)
+            {
+                throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+            }
+            return *_position++;
+        }
+    };
+
+    // true when every instruction lies within the module, which the compact encoding relies on
+    bool is_spirv(const std::vector<uint32_t> &code)
+    {
+        if (code.size() < spirv_header_words || code[0] != spirv_magic)
+        {
+            return false;
+        }
+        for (size_t offset = spirv_header_words; offset < code.size();)
+        {
+            const uint32_t word_count = code[offset] >> 16;
+            if (word_count == 0 || word_count > code.size() - offset)
+            {
+                return false;
+            }
+            offset += word_count;
+        }
+        return true;
+    }
+
+    void encode_operand(std::vector<uint8_t> &output, operand_kind kind, uint32_t word, uint32_t cursor)
+    {
+        switch (kind)
+        {
+        case operand_kind::literal:
+            write_varint(output, word);
+            break;
+        case operand_kind::relative:
+            write_varint(output, zigzag(word - cursor));
+            break;
+        case operand_kind::raw:
+            write_raw(output, word);
+            break;
+        }
+    }
+
+    uint32_t decode_operand(reader &input, operand_kind kind, uint32_t cursor)
+    {
+        switch (kind)
+        {
+        case operand_kind::literal:
+            return input.varint();
+        case operand_kind::relative:
+            return unzigzag(input.varint()) + cursor;
+        default:
+            return input.raw();
+        }
+    }
+
+    void encode_compact(const std::vector<uint32_t> &code, std::vector<uint8_t> &output)
+    {
+        // ids are mostly close to the most recent result, so they are stored as deltas from it
+        uint32_t cursor = 0;
+        for (size_t index = 0; index < spirv_header_words; index++)
+        {
+            write_varint(output, code[index]);
+        }
+        for (size_t offset = spirv_header_words; offset < code.size();)
+        {
+            const uint32_t opcode = code[offset] & 0xFFFF;
+            const uint32_t word_count = code[offset] >> 16;
+            const instruction_traits traits = get_traits(opcode);
+            size_t index = 1;
+            write_varint(output, (opcode << 4) | std::min(word_count, inline_word_count_limit));
+            if (word_count >= inline_word_count_limit)
+            {
+                write_varint(output, word_count);
+            }
+            if (traits.type && index < word_count)
+            {
+                write_varint(output, code[offset + index++]);
+            }
+            if (traits.result && index < word_count)
+            {
+                write_varint(output, zigzag(code[offset + index] - cursor));
+                cursor = code[offset + index++];
+            }
+            for (; index < word_count; index++)
+            {
+                encode_operand(output, traits.operands, code[offset + index], cursor);
+            }
+            offset += word_count;
+        }
+    }
+
+    void decode_compact(reader &input, uint32_t *code, size_t size)
+    {
+        uint32_t cursor = 0;
+        if (size < spirv_header_words)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+        for (size_t index = 0; index < spirv_header_words; index++)
+        {
+            code[index] = input.varint();
+        }
+        for (size_t offset = spirv_header_words; offset < size;)
+        {
+            const uint32_t packed = input.varint();
+            const uint32_t opcode = packed >> 4;
+            const uint32_t word_count = (packed & 0xF) < inline_word_count_limit ? (packed & 0xF) : input.varint();
+            const instruction_traits traits = get_traits(opcode);
+            size_t index = 1;
+            if (word_count == 0 || opcode > 0xFFFF || word_count > size - offset)
+            {
+                throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+            }
+            code[offset] = (word_count << 16) | opcode;
+            if (traits.type && index < word_count)
+            {
+                code[offset + index++] = input.varint();
+            }
+            if (traits.result && index < word_count)
+            {
+                cursor += unzigzag(input.varint());
+                code[offset + index++] = cursor;
+            }
+            for (; index < word_count; index++)
+            {
+                code[offset + index] = decode_operand(input, traits.operands, cursor);
+            }
+            offset += word_count;
+        }
+    }
+}
+
+bool vsm::encoding::is_encoded(const void *data, size_t size)
+{
+    uint32_t magic;
+    if (size < sizeof(magic))
+    {
+        return false;
+    }
+    memcpy(&magic, data, sizeof(magic));
+    return magic == encoded_magic;
+}
+
+void vsm::encoding::encode(VsmCodeEncoding encoding, const std::vector<uint32_t> &code, std::vector<uint8_t> &output)
+{
+    if (encoding == VSM_CODE_ENCODING_COMPACT && !is_spirv(code))
+    {
+        encoding = VSM_CODE_ENCODING_VARINT;
+    }
+    output.clear();
+    write_raw(output, encoded_magic);
+    output.push_back(static_cast<uint8_t>(encoding));
+    write_varint(output, static_cast<uint32_t>(code.size()));
+    switch (encoding)
+    {
+    case VSM_CODE_ENCODING_VARINT:
+        for (uint32_t word : code)
+        {
+            write_varint(output, word);
+        }
+        break;
+    case VSM_CODE_ENCODING_COMPACT:
+        encode_compact(code, output);
+        break;
+    default:
+        throw vsm::exception(VSM_ERROR_CODE_ENCODING);
+    }
+}
+
+void vsm::encoding::decode(const void *data, size_t size, std::vector<uint32_t> &code)
+{
+    reader input(static_cast<const uint8_t *>(data), size);
+    if (input.raw() != encoded_magic)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+    const uint8_t encoding = input.byte();
+    const uint32_t word_count = input.varint();
+    // every word takes at least one byte, which bounds the allocation for corrupt input
+    if (word_count > size)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+    code.resize(word_count);
+    switch (encoding)
+    {
+    case VSM_CODE_ENCODING_VARINT:
+        for (uint32_t &word : code)
+        {
+            word = input.varint();
+        }
+        break;
+    case VSM_CODE_ENCODING_COMPACT:
+        decode_compact(input, code.data(), code.size());
+        break;
+    default:
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+    if (!input.empty())
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.hpp"
+
+#include <fstream>
+
+namespace
+{
+    // owns what glslang reads until it frees the result
+    struct include_result : glsl_include_result_t
+    {
+        std::string name;
+        std::shared_ptr<const std::string> contents;
+    };
+
+    glsl_include_result_t *include(void *context, const char *header_name, const char *includer_name, bool local)
+    {
+        vsm::includer::session &session = *static_cast<vsm::includer::session *>(context);
+        std::unique_ptr<include_result> result(new include_result);
+        uint64_t hash;
+        if (session.owner.resolve(vsm::utilities::make_string(header_name), vsm::utilities::make_string(includer_name), local, result->name, result->contents, hash))
+        {
+            // a header included twice is one dependency
+            const auto same = [&](const vsm::dependency &dependency)
+            { return dependency.name == result->name; };
+            if (std::find_if(session.dependencies.begin(), session.dependencies.end(), same) == session.dependencies.end())
+            {
+                session.dependencies.push_back({result->name, hash});
+            }
+        }
+        else
+        {
+            // glslang reports an empty header name as an unresolved include
+            result->name.clear();
+            result->contents = std::make_shared<const std::string>();
+        }
+        result->header_name = result->name.c_str();
+        result->header_data = result->contents->data();
+        result->header_length = result->contents->size();
+        return result.release();
+    }
+
+    glsl_include_result_t *include_local(void *context, const char *header_name, const char *includer_name, size_t depth)
+    {
+        return include(context, header_name, includer_name, true);
+    }
+
+    glsl_include_result_t *include_system(void *context, const char *header_name, const char *includer_name, size_t depth)
+    {
+        return include(context, header_name, includer_name, false);
+    }
+
+    int free_include_result(void *context, glsl_include_result_t *result)
+    {
+        delete static_cast<include_result *>(result);
+        return 0;
+    }
+}
+
+vsm::includer::includer(const std::vector<std::string> &paths, PFN_vsmIncludeCallback callback, void *user_data) : _paths(paths.begin(), paths.end()), _callback(callback), _user_data(user_data)
+{
+}
+
+bool vsm::includer::read(const std::filesystem::path &path, file &result)
+{
+    std::error_code error;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    const uintmax_t size = error ? 0 : std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+    const std::string key = path.string();
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        const auto position = _files.find(key);
+        if (position != _files.end() && position->second.time == time && position->second.size == size)
+        {
+            result = position->second;
+            return true;
+        }
+    }
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        return false;
+    }
+    std::shared_ptr<const std::string> contents = std::make_shared<const std::string>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    result = {time, size, vsm::utilities::hash(contents->data(), contents->size()), std::move(contents)};
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    _files[key] = result;
+    return true;
+}
+
+bool vsm::includer::resolve(const std::string &header, const std::string &includer, bool local, std::string &name, std::shared_ptr<const std::string> &contents, uint64_t &hash)
+{
+    const char *data = nullptr;
+    size_t size = 0;
+    if (_callback != nullptr && _callback(header.c_str(), includer.c_str(), local ? VK_TRUE : VK_FALSE, _user_data, &data, &size) == VK_TRUE)
+    {
+        name = header;
+        contents = std::make_shared<const std::string>(data != nullptr ? data : "", data != nullptr ? size : 0);
+        hash = vsm::utilities::hash(contents->data(), contents->size());
+        return true;
+    }
+    // a quoted include is looked for next to the header that includes it first
+    std::vector<std::filesystem::path> candidates;
+    if (local && !includer.empty())
+    {
+        candidates.push_back(std::filesystem::path(includer).parent_path() / header);
+    }
+    for (const std::filesystem::path &path : _paths)
+    {
+        candidates.push_back(path / header);
+    }
+    for (const std::filesystem::path &candidate : candidates)
+    {
+        const std::filesystem::path path = candidate.lexically_normal();
+        file found;
+        if (read(path, found))
+        {
+            name = path.string();
+            contents = std::move(found.contents);
+            hash = found.hash;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool vsm::includer::hash(const std::string &name, uint64_t &hash)
+{
+    // a resolved name is either one the callback resolved or the path of a file
+    const char *data = nullptr;
+    size_t size = 0;
+    file found;
+    if (_callback != nullptr && _callback(name.c_str(), "", VK_TRUE, _user_data, &data, &size) == VK_TRUE)
+    {
+        hash = vsm::utilities::hash(data, data != nullptr ? size : 0);
+        return true;
+    }
+    if (read(name, found))
+    {
+        hash = found.hash;
+        return true;
+    }
+    return false;
+}
+
+glsl_include_callbacks_t vsm::includer::callbacks()
+{
+    return {include_system, include_local, free_include_result};
+}
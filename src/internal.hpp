@@ -25,14 +25,26 @@
 
 #include "vk_shader_manager.h"
 
+#include <glslang/build_info.h>
 #include <glslang/Include/glslang_c_interface.h>
 #include <glslang/Public/resource_limits_c.h>
+#include <spirv-tools/libspirv.h>
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -48,49 +60,702 @@ namespace vsm
         VsmResult result() const { return _result; }
     };
 
+    // non-owning reference to a callable, used where std::function could allocate
+    template <typename Signature>
+    class function_ref;
+
+    template <typename Result, typename... Args>
+    class function_ref<Result(Args...)>
+    {
+    private:
+        void *_callable;
+        Result (*_invoke)(void *, Args...);
+    public:
+        template <typename Callable, typename = std::enable_if_t<!std::is_same<std::decay_t<Callable>, function_ref>::value>>
+        function_ref(Callable &&callable) : _callable(const_cast<void *>(static_cast<const void *>(std::addressof(callable)))),
+                                             _invoke([](void *callable, Args... args) -> Result
+                                                     { return (*static_cast<std::remove_reference_t<Callable> *>(callable))(std::forward<Args>(args)...); })
+        {
+        }
+        Result operator()(Args... args) const { return _invoke(_callable, std::forward<Args>(args)...); }
+    };
+
     void glsl_preprocess(std::unique_ptr<glslang_shader_t, decltype(&glslang_shader_delete)> &shader, const glslang_input_t *input);
     void glsl_parse(std::unique_ptr<glslang_shader_t, decltype(&glslang_shader_delete)> &shader, const glslang_input_t *input);
     void glsl_link(std::unique_ptr<glslang_program_t, decltype(&glslang_program_delete)> &program, int messages);
 
+    // the SPIR-V passes run after compiling, as space separated spirv-opt flags, and where their
+    // timings are reported
+    struct optimization
+    {
+        std::string passes;
+        PFN_vsmPassTimingCallback timing;
+        void *user_data;
+        // stores glslang's code first and optimizes it on a worker
+        bool tiered;
+    };
+
+    namespace optimizer
+    {
+        optimization configure(const VsmOptimizationInfo &optimization_info);
+        void run(spv_target_env environment, const std::string &name, const optimization &optimization, std::vector<uint32_t> &code);
+    }
+
+    // a SHA-256 digest, for identities a 64-bit hash may confuse
+    struct digest
+    {
+        uint8_t bytes[32];
+        bool operator==(const digest &other) const;
+        bool operator!=(const digest &other) const;
+        // buckets digests by their leading bytes, which are already uniformly distributed
+        struct hasher
+        {
+            size_t operator()(const digest &value) const;
+        };
+    };
+
+    class sha256
+    {
+    private:
+        uint32_t _state[8];
+        uint8_t _block[64];
+        size_t _used;
+        uint64_t _size;
+        void compress();
+    public:
+        sha256();
+        void update(const void *data, size_t size);
+        digest finish();
+        static digest of(const void *data, size_t size);
+    };
+
+    // everything a shader is compiled from, with its defines written out as a preamble
+    struct compile_request
+    {
+        std::string name;
+        VsmShaderStage stage;
+        std::string preamble;
+        std::string source;
+        vsm::optimization optimization;
+    };
+
+    // a header a shader included, with the hash of the contents it was compiled with
+    struct dependency
+    {
+        std::string name;
+        uint64_t hash;
+    };
+
+    // resolves #include directives for glslang, keeping headers read from disk in memory
+    class includer
+    {
+    private:
+        struct file
+        {
+            std::filesystem::file_time_type time;
+            uintmax_t size;
+            uint64_t hash;
+            std::shared_ptr<const std::string> contents;
+        };
+        std::vector<std::filesystem::path> _paths;
+        PFN_vsmIncludeCallback _callback;
+        void *_user_data;
+        std::shared_mutex _mutex;
+        std::unordered_map<std::string, file> _files;
+        bool read(const std::filesystem::path &path, file &result);
+    public:
+        // the includer and the headers one compile resolved through it
+        struct session
+        {
+            includer &owner;
+            std::vector<dependency> dependencies;
+        };
+        includer(const std::vector<std::string> &paths, PFN_vsmIncludeCallback callback, void *user_data);
+        // finds the name, contents and hash of an included header, false if nothing resolves it
+        bool resolve(const std::string &header, const std::string &includer, bool local, std::string &name, std::shared_ptr<const std::string> &contents, uint64_t &hash);
+        // the hash of the current contents of a resolved header, false if it no longer resolves
+        bool hash(const std::string &name, uint64_t &hash);
+        // callbacks for glslang_input_t, whose context is a session
+        static glsl_include_callbacks_t callbacks();
+    };
+
     class compiler
     {
     private:
         glslang_target_client_version_t _vk_version;
         glslang_target_language_version_t _spv_version;
+        spv_target_env _environment;
+        std::unique_ptr<includer> _includer;
+        // the request's preamble, enabling #include when the compiler has an includer
+        std::string preamble(const compile_request &request) const;
     public:
-        compiler(VsmVulkanVersion vk_version, VsmSPVVersion spv_version);
-        ~compiler() = default;
-        void compile(const std::string &name, VsmShaderStage stage, const std::string &source, std::vector<uint32_t> &code);
+        // every compiler holds a reference to glslang's process state
+        compiler(VsmVulkanVersion vk_version, VsmSPVVersion spv_version, std::unique_ptr<includer> includer = nullptr);
+        compiler(const compiler &) = delete;
+        compiler &operator=(const compiler &) = delete;
+        ~compiler();
+        // identifies everything that affects the compiled code, so unchanged shaders are not recompiled
+        digest key(const compile_request &request) const;
+        // the key does not cover included headers, so a source that may include them is only
+        // current while its dependencies are
+        bool includes(const std::string &source) const;
+        bool hash_header(const std::string &name, uint64_t &hash);
+        // optimizes the code unless the request is tiered, which leaves that to optimize, and
+        // records the reflection data of the code it returns
+        void compile(const compile_request &request, std::vector<uint32_t> &code, std::vector<uint32_t> &reflection, std::vector<dependency> &dependencies);
+        void optimize(const compile_request &request, std::vector<uint32_t> &code) const;
+    };
+
+    namespace encoding
+    {
+        bool is_encoded(const void *data, size_t size);
+        void encode(VsmCodeEncoding encoding, const std::vector<uint32_t> &code, std::vector<uint8_t> &output);
+        void decode(const void *data, size_t size, std::vector<uint32_t> &code);
+    }
+
+    // debug instructions are kept apart from the code, so release loads read less
+    namespace debug_info
+    {
+        void strip(const std::vector<uint32_t> &code, std::vector<uint32_t> &stripped, std::vector<uint32_t> &debug);
+        void merge(const uint32_t *stripped, size_t size, const uint32_t *debug, size_t debug_size, std::vector<uint32_t> &code);
+    }
+
+    // a compact record of what a shader binds and passes between stages, read without parsing code
+    namespace reflection
+    {
+        void reflect(const std::vector<uint32_t> &code, std::vector<uint32_t> &record);
+        VsmResult read(const void *data, size_t size, VsmShaderReflection &reflection);
+    }
+
+    // the device and driver build pipeline cache data was created by, which only it can use
+    struct pipeline_cache_key
+    {
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint8_t uuid[VK_UUID_SIZE];
+    };
+
+    namespace pipeline_cache
+    {
+        pipeline_cache_key key(const VkPhysicalDeviceProperties &properties);
+        // reads the key from the header, false if the data does not start with a valid one
+        bool key(const void *data, size_t size, pipeline_cache_key &key);
+        bool equal(const pipeline_cache_key &left, const pipeline_cache_key &right);
+        // reads the whole of a cache's data from the driver
+        void data(VkDevice device, VkPipelineCache cache, std::vector<uint8_t> &data);
+        // merges the source cache into a temporary one created from stored data, and reads the result
+        void merge(VkDevice device, const VkAllocationCallbacks *allocator, const void *stored, size_t size, VkPipelineCache source, std::vector<uint8_t> &merged);
+    }
+
+    // where a shader's decoded code, and optionally its reflection record, lie in an arena
+    struct code_location
+    {
+        size_t offset;
+        size_t size;
+        VsmShaderStage stage;
+        size_t reflection_offset;
+        // in bytes, 0 for a shader without a reflection record
+        size_t reflection_size;
     };
 
+    // storage backend interface, implemented by the sqlite, memory and pack repositories
     class repository
     {
+    protected:
+        // guards each backend's state, held for the whole of a transaction
+        std::recursive_mutex _mutex;
+        virtual void begin() = 0;
+        virtual void commit() = 0;
+        virtual void rollback() = 0;
+        // reads every shader into an arena of decoded code, shaders with the same code sharing it,
+        // followed by their reflection records when asked for
+        void collect(std::vector<uint32_t> &arena, std::unordered_map<std::string, code_location> &entries, bool reflection);
+    public:
+        // groups writes into a single transaction, which is rolled back unless committed
+        class transaction
+        {
+        private:
+            repository &_repository;
+            std::unique_lock<std::recursive_mutex> _lock;
+            bool _committed;
+        public:
+            transaction(repository &repository);
+            ~transaction();
+            void commit();
+        };
+        static std::unique_ptr<repository> create(VsmRepositoryFormat format, const std::string &path, bool shared, VsmCodeEncoding encoding, bool debug_info);
+        repository() = default;
+        virtual ~repository() = default;
+        virtual void store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) = 0;
+        virtual bool cached(const std::string &name, const digest &key) = 0;
+        // swaps in new code if the shader still has the previous code
+        virtual bool replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) = 0;
+        // bumped by every write of a shader's code
+        virtual uint64_t generation(const std::string &name) = 0;
+        // records the source and headers a shader was compiled from, or forgets them if it has none
+        virtual void store_source(const compile_request &request, const std::vector<dependency> &dependencies) = 0;
+        // fills in the preamble and source, false if the shader has no recorded source
+        virtual bool load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies) = 0;
+        // visits every recorded dependency with the shader that has it
+        virtual void enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor) = 0;
+        void load(const std::string &name, std::vector<uint32_t> &code);
+        // the visitor sees the stored code in place and must not keep the pointer
+        virtual void load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor) = 0;
+        // loads several shaders in one pass, visiting each with its index and skipping those that fail to load
+        virtual void load(const std::vector<std::string> &names, function_ref<void(size_t, const uint32_t *, size_t)> visitor);
+        // visits the reflection record stored with the code, false if the shader has none
+        virtual bool load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor) = 0;
+        // keeps one pipeline cache blob per device and driver build
+        virtual void store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size) = 0;
+        // visits the data stored for the key, false if there is none
+        virtual bool load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor) = 0;
+        virtual std::pair<bool, VsmShaderStage> query(const std::string &name) = 0;
+        virtual void remove(const std::string &name) = 0;
+        virtual void clear() = 0;
+        // visits every shader with its decoded code, which the visitor must not keep
+        virtual void enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor) = 0;
+        // reads every shader into memory, for backends that are not in memory already
+        virtual void preload();
+        void export_pack(const std::string &path);
+    };
+
+    class sqlite_repository : public repository
+    {
     private:
+        using statement = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)>;
+        using statement_reset = std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_reset)>;
         static std::unique_ptr<sqlite3, decltype(&sqlite3_close)> open_db(const std::string &path, bool shared);
         static void init_db(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db);
+        static void migrate_db(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db);
+        static void hash_function(sqlite3_context *context, int argc, sqlite3_value **argv);
+        // split the code of a blob written before debug instructions were kept apart, for migrations
+        static void digest_function(sqlite3_context *context, int argc, sqlite3_value **argv);
+        static void strip_function(sqlite3_context *context, int argc, sqlite3_value **argv);
+        static void debug_function(sqlite3_context *context, int argc, sqlite3_value **argv);
+        static statement prepare(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db, const std::string &sql, VsmResult error);
+        // read only connection with its own statements, used by one thread at a time
+        struct reader
+        {
+            std::unique_ptr<sqlite3, decltype(&sqlite3_close)> db;
+            statement cached_stmt;
+            statement load_stmt;
+            statement load_reflection_stmt;
+            statement query_stmt;
+            statement load_source_stmt;
+            statement load_dependencies_stmt;
+        };
+        // borrows a pooled reader, or locks the writer when the repository has no pool
+        class read_lock
+        {
+        private:
+            sqlite_repository &_repository;
+            std::unique_ptr<reader> _reader;
+            std::unique_lock<std::recursive_mutex> _lock;
+        public:
+            read_lock(sqlite_repository &repository);
+            ~read_lock();
+            sqlite3_stmt *cached_stmt() const;
+            sqlite3_stmt *load_stmt() const;
+            sqlite3_stmt *load_reflection_stmt() const;
+            sqlite3_stmt *query_stmt() const;
+            sqlite3_stmt *load_source_stmt() const;
+            sqlite3_stmt *load_dependencies_stmt() const;
+        };
+        std::unique_ptr<reader> open_reader() const;
+        void store_blob(const digest &hash, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection);
+        void store_debug_info(const std::string &name, const std::vector<uint32_t> &debug);
+        // visits the code in the row a load statement stepped to
+        void visit(sqlite3_stmt *stmt, function_ref<void(const uint32_t *, size_t)> visitor);
+        bool find_preloaded(const std::string &name, code_location &entry);
+        void forget_preloaded(const std::string &name);
+        // statements are declared after the connection so they are finalized before it is closed
         std::unique_ptr<sqlite3, decltype(&sqlite3_close)> _db;
+        statement _store_blob_stmt;
+        statement _store_stmt;
+        statement _store_source_stmt;
+        statement _store_dependency_stmt;
+        statement _remove_source_stmt;
+        statement _remove_dependencies_stmt;
+        statement _load_source_stmt;
+        statement _load_dependencies_stmt;
+        statement _cached_stmt;
+        statement _replace_stmt;
+        statement _generation_stmt;
+        statement _store_debug_info_stmt;
+        statement _remove_debug_info_stmt;
+        statement _load_stmt;
+        statement _load_reflection_stmt;
+        statement _store_pipeline_cache_stmt;
+        statement _load_pipeline_cache_stmt;
+        statement _query_stmt;
+        statement _remove_stmt;
+        statement _clear_stmt;
+        statement _begin_stmt;
+        statement _commit_stmt;
+        statement _rollback_stmt;
+        VsmCodeEncoding _encoding;
+        // whether loads merge the debug instructions back into the code
+        bool _debug_info;
+        // shared file repositories run in WAL mode, so readers proceed alongside the writer
+        std::string _path;
+        bool _pooled;
+        std::vector<std::unique_ptr<reader>> _readers;
+        std::mutex _readers_mutex;
+        // the arena is only written by preload, so code in it stays valid after entries are forgotten
+        std::vector<uint32_t> _arena;
+        std::unordered_map<std::string, code_location> _preloaded;
+        std::shared_mutex _preloaded_mutex;
+    protected:
+        void begin() override;
+        void commit() override;
+        void rollback() override;
     public:
-        repository(const std::string &path, bool shared);
-        ~repository() = default;
-        void store(const std::string &name, VsmShaderStage stage, const std::vector<uint32_t> &code);
-        void load(const std::string &name, std::vector<uint32_t> &code);
-        std::pair<bool, VsmShaderStage> query(const std::string &name);
-        void remove(const std::string &name);
+        sqlite_repository(const std::string &path, bool shared, VsmCodeEncoding encoding, bool debug_info);
+        ~sqlite_repository() override = default;
+        using repository::load;
+        void store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        bool cached(const std::string &name, const digest &key) override;
+        bool replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        uint64_t generation(const std::string &name) override;
+        void store_source(const compile_request &request, const std::vector<dependency> &dependencies) override;
+        bool load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies) override;
+        void enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor) override;
+        void load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor) override;
+        void load(const std::vector<std::string> &names, function_ref<void(size_t, const uint32_t *, size_t)> visitor) override;
+        bool load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor) override;
+        void store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size) override;
+        bool load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor) override;
+        std::pair<bool, VsmShaderStage> query(const std::string &name) override;
+        void remove(const std::string &name) override;
+        void clear() override;
+        void enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor) override;
+        // serves later loads and queries from memory, until the shader is written again
+        void preload() override;
+    };
+
+    // keeps shaders in a hash table, for repositories that do not outlive their context
+    class memory_repository : public repository
+    {
+    private:
+        struct shader
+        {
+            VsmShaderStage stage;
+            digest key;
+            // the digest of the code, which identifies its blob
+            digest hash;
+            std::shared_ptr<const std::vector<uint32_t>> code;
+            // null when the code had no debug instructions
+            std::shared_ptr<const std::vector<uint32_t>> debug_info;
+            // null when the shader was stored without reflection data
+            std::shared_ptr<const std::vector<uint32_t>> reflection;
+            uint64_t generation;
+            std::string preamble;
+            std::string source;
+            std::string passes;
+            std::vector<dependency> dependencies;
+        };
+        std::unordered_map<std::string, shader> _shaders;
+        // shaders with the same code share it, as they do in the sqlite repository
+        std::unordered_map<digest, std::weak_ptr<const std::vector<uint32_t>>, digest::hasher> _blobs;
+        // the previous state of each shader written in a transaction, and where each savepoint starts
+        std::vector<std::pair<std::string, std::unique_ptr<shader>>> _journal;
+        std::vector<size_t> _savepoints;
+        // searched in order, as a context sees a handful of devices at most
+        std::vector<std::pair<pipeline_cache_key, std::vector<uint8_t>>> _pipeline_caches;
+        // whether loads merge the debug instructions back into the code
+        bool _debug_info;
+        void record(const std::string &name);
+        std::shared_ptr<const std::vector<uint32_t>> intern(const digest &hash, const std::vector<uint32_t> &code);
+        void release(const digest &hash);
+        const shader &find(const std::string &name, VsmResult error) const;
+    protected:
+        void begin() override;
+        void commit() override;
+        void rollback() override;
+    public:
+        memory_repository(bool debug_info);
+        ~memory_repository() override = default;
+        using repository::load;
+        void store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        bool cached(const std::string &name, const digest &key) override;
+        bool replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        uint64_t generation(const std::string &name) override;
+        void store_source(const compile_request &request, const std::vector<dependency> &dependencies) override;
+        bool load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies) override;
+        void enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor) override;
+        void load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor) override;
+        bool load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor) override;
+        void store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size) override;
+        bool load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor) override;
+        std::pair<bool, VsmShaderStage> query(const std::string &name) override;
+        void remove(const std::string &name) override;
+        void clear() override;
+        void enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor) override;
+    };
+
+    // read only shader file, mapped into memory so code is used where it lies
+    class pack_repository : public repository
+    {
+    private:
+        const uint8_t *_data;
+        size_t _size;
+        uint32_t _count;
+#ifdef _WIN32
+        void *_file;
+        void *_mapping;
+#else
+        int _file;
+#endif
+        void release();
+        const void *find(const std::string &name) const;
+    protected:
+        void begin() override;
+        void commit() override;
+        void rollback() override;
+    public:
+        static void write(const std::string &path, const std::vector<uint32_t> &arena, const std::unordered_map<std::string, code_location> &entries);
+        pack_repository(const std::string &path);
+        ~pack_repository() override;
+        using repository::load;
+        void store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        bool cached(const std::string &name, const digest &key) override;
+        bool replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection) override;
+        uint64_t generation(const std::string &name) override;
+        void store_source(const compile_request &request, const std::vector<dependency> &dependencies) override;
+        bool load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies) override;
+        void enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor) override;
+        void load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor) override;
+        bool load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor) override;
+        void store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size) override;
+        bool load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor) override;
+        std::pair<bool, VsmShaderStage> query(const std::string &name) override;
+        void remove(const std::string &name) override;
+        void clear() override;
+        void enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor) override;
+    };
+
+    class cache
+    {
+    public:
+        using shared_code = std::shared_ptr<const std::vector<uint32_t>>;
+    private:
+        struct entry
+        {
+            std::string name;
+            shared_code code;
+        };
+        // most recently used first
+        std::list<entry> _entries;
+        std::unordered_map<std::string, std::list<entry>::iterator> _index;
+        size_t _budget;
+        size_t _size;
+        // bumped by every invalidation, so a load that raced with a write is not cached
+        uint64_t _generation;
+        VsmCacheStatistics _statistics;
+        std::mutex _mutex;
+        void erase(std::list<entry>::iterator position);
+    public:
+        cache(size_t budget);
+        ~cache() = default;
+        bool enabled() const;
+        shared_code find(const std::string &name, uint64_t &generation);
+        void insert(const std::string &name, shared_code code, uint64_t generation);
+        void invalidate(const std::string &name);
+        void clear();
+        VsmCacheStatistics statistics();
+    };
+
+    // resolves each name to one handle, which keeps what was last read for its shader
+    class registry
+    {
+    private:
+        std::unordered_map<std::string, std::unique_ptr<VsmShader_T>> _shaders;
+        std::mutex _mutex;
+        static void reset(VsmShader shader);
+    public:
+        registry() = default;
+        ~registry();
+        VsmShader get(const std::string &name);
+        VsmShaderStage query(VsmShader shader, repository &repository);
+        cache::shared_code load(VsmShader shader, repository &repository);
+        // the code with the stage it was stored with, read from the same write of the shader
+        cache::shared_code load(VsmShader shader, repository &repository, VsmShaderStage &stage);
+        void invalidate(const std::string &name);
         void clear();
     };
 
+    // shader modules shared by every caller on the same device, until the shader is written again
+    class module_cache
+    {
+    private:
+        struct entry
+        {
+            VkDevice device;
+            std::string name;
+            // the module is destroyed with the allocator it was created with
+            const VkAllocationCallbacks *allocator;
+            uint32_t references;
+            // cleared when the shader is written, so later requests create a new module
+            bool current;
+        };
+        std::unordered_map<VkShaderModule, entry> _modules;
+        std::unordered_map<std::string, std::unordered_map<VkDevice, VkShaderModule>> _current;
+        bool _enabled;
+        // bumped by every invalidation, so a module created from code that raced with a write is not shared
+        uint64_t _generation;
+        std::mutex _mutex;
+    public:
+        module_cache(bool enabled);
+        ~module_cache();
+        bool enabled() const;
+        VkShaderModule find(VkDevice device, const std::string &name, uint64_t &generation);
+        VkShaderModule insert(VkDevice device, const std::string &name, VkShaderModule module, const VkAllocationCallbacks *allocator, uint64_t generation);
+        bool release(VkShaderModule module);
+        void invalidate(const std::string &name);
+        void clear();
+    };
+
+    // code handed out inline in pipeline stages, kept alive until each hand out is released
+    class pin_list
+    {
+    private:
+        struct entry
+        {
+            cache::shared_code code;
+            uint32_t references;
+        };
+        std::unordered_map<const uint32_t *, entry> _pins;
+        std::mutex _mutex;
+    public:
+        pin_list() = default;
+        ~pin_list() = default;
+        const uint32_t *pin(cache::shared_code code);
+        void release(const uint32_t *code);
+    };
+
+    // jobs started by vsmCompileShaderAsync, until they are destroyed
+    class job_list
+    {
+    private:
+        std::unordered_map<VsmJob, std::unique_ptr<VsmJob_T>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        VsmJob_T &find(VsmJob job);
+    public:
+        job_list() = default;
+        ~job_list();
+        VsmJob create(bool detached);
+        void complete(VsmJob job, VsmResult result);
+        VsmResult poll(VsmJob job);
+        VsmResult wait(uint32_t count, const VsmJob *jobs);
+        // waits until every job is done, including detached ones nobody holds
+        void wait_all();
+        void destroy(VsmJob job);
+    };
+
+    class worker_pool
+    {
+    private:
+        std::vector<std::thread> _threads;
+        std::deque<std::function<void()>> _tasks;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _stopping;
+        void run();
+    public:
+        worker_pool(size_t size);
+        ~worker_pool();
+        size_t size() const;
+        // runs the pending tasks and joins the workers, after which no task is accepted
+        void stop();
+        // false, without running the task, once the pool is stopping
+        bool submit(std::function<void()> task);
+        void parallel_for(size_t count, const std::function<void(size_t)> &body);
+    };
+
     namespace utilities
     {
         std::string make_string(const char *raw);
+        uint64_t hash(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL);
+        template <typename T>
+        const T *find_next(const void *next, VsmStructureType type);
         std::unique_ptr<vsm::compiler> &get_compiler(VsmContext context);
         std::unique_ptr<vsm::repository> &get_repository(VsmContext context);
+        std::unique_ptr<vsm::worker_pool> &get_workers(VsmContext context);
+        std::unique_ptr<vsm::cache> &get_cache(VsmContext context);
+        std::unique_ptr<vsm::registry> &get_registry(VsmContext context);
+        std::unique_ptr<vsm::module_cache> &get_modules(VsmContext context);
+        std::unique_ptr<vsm::pin_list> &get_pins(VsmContext context);
+        VkShaderStageFlagBits stage_flag(VsmShaderStage stage);
+        std::unique_ptr<vsm::job_list> &get_jobs(VsmContext context);
+        const vsm::optimization &get_optimization(VsmContext context);
+        // optimizes stored code of a tiered request on a worker and swaps it in
+        void optimize_later(VsmContext context, const compile_request &request, std::vector<uint32_t> code);
+        // compiles a shader unless it is stored unchanged, the work behind vsmCompileShader
+        // applies the context's default optimization unless the compile info overrides it
+        compile_request make_request(VsmContext context, const VsmShaderCompileInfo &compile_info);
+        void compile(VsmContext context, const compile_request &request);
+        // compiles shaders in parallel and stores them in one transaction, the work behind vsmCompileShaders
+        VsmResult compile(VsmContext context, const std::vector<compile_request> &requests, VsmResult *results);
+        // whether the stored shader was compiled from this request and headers that are unchanged
+        bool current(VsmContext context, const compile_request &request, const digest &key);
+        void invalidate(VsmContext context, const std::string &name);
+        void invalidate_all(VsmContext context);
+        void create_module(const VsmShaderModuleCreateInfo &create_info, const VkAllocationCallbacks *allocator, const uint32_t *code, size_t size, VkShaderModule &module);
+        // loads the shaders in one repository pass and creates their modules in parallel, the work behind vsmCreateShaderModules
+        VsmResult create_modules(VsmContext context, uint32_t count, const VsmShaderModuleCreateInfo *create_infos, const VkAllocationCallbacks *allocator, VkShaderModule *modules, VsmResult *results);
     }
 }
 
+template <typename T>
+const T *vsm::utilities::find_next(const void *next, VsmStructureType type)
+{
+    // every extension structure starts with sType and pNext
+    struct header
+    {
+        VsmStructureType sType;
+        const void *pNext;
+    };
+    while (next != nullptr && static_cast<const header *>(next)->sType != type)
+    {
+        next = static_cast<const header *>(next)->pNext;
+    }
+    return static_cast<const T *>(next);
+}
+
+struct VsmShader_T
+{
+    std::string name;
+    // guards the resolved state below, which writes to the shader reset
+    std::mutex mutex;
+    // bumped on every reset, so a read that raced with a write is not kept
+    uint64_t generation;
+    bool resolved;
+    VsmShaderStage stage;
+    vsm::cache::shared_code code;
+};
+
+struct VsmJob_T
+{
+    // guarded by the job list's mutex
+    bool done;
+    // destroyed as soon as it is done, as nobody holds the handle
+    bool detached;
+    VsmResult result;
+};
+
 struct VsmContext_T
 {
     std::unique_ptr<vsm::compiler> compiler;
     std::unique_ptr<vsm::repository> repository;
+    std::unique_ptr<vsm::cache> cache;
+    std::unique_ptr<vsm::registry> registry;
+    std::unique_ptr<vsm::module_cache> modules;
+    std::unique_ptr<vsm::pin_list> pins;
+    std::unique_ptr<vsm::job_list> jobs;
+    vsm::optimization optimization;
+    std::once_flag workers_flag;
+    std::unique_ptr<vsm::worker_pool> workers;
 };
 
 #endif
\ No newline at end of file
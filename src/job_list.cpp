@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::job_list::~job_list()
+{
+}
+
+VsmJob_T &vsm::job_list::find(VsmJob job)
+{
+    const auto position = _jobs.find(job);
+    if (position == _jobs.end())
+    {
+        throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+    }
+    return *position->second;
+}
+
+VsmJob vsm::job_list::create(bool detached)
+{
+    std::unique_ptr<VsmJob_T> job(new VsmJob_T{false, detached, VSM_NOT_READY});
+    const VsmJob result = job.get();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jobs.emplace(result, std::move(job));
+    return result;
+}
+
+void vsm::job_list::complete(VsmJob job, VsmResult result)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        VsmJob_T &entry = find(job);
+        if (entry.detached)
+        {
+            _jobs.erase(job);
+        }
+        else
+        {
+            entry.done = true;
+            entry.result = result;
+        }
+    }
+    _condition.notify_all();
+}
+
+VsmResult vsm::job_list::poll(VsmJob job)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return find(job).result;
+}
+
+VsmResult vsm::job_list::wait(uint32_t count, const VsmJob *jobs)
+{
+    VsmResult result = VSM_SUCCESS;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (uint32_t index = 0; index < count; index++)
+    {
+        VsmJob_T &entry = find(jobs[index]);
+        _condition.wait(lock, [&entry]()
+                        { return entry.done; });
+        if (result == VSM_SUCCESS)
+        {
+            result = entry.result;
+        }
+    }
+    return result;
+}
+
+void vsm::job_list::wait_all()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    // detached jobs leave the list when they are done
+    _condition.wait(lock, [this]()
+                    { return std::all_of(_jobs.begin(), _jobs.end(), [](const auto &entry)
+                                         { return entry.second->done; }); });
+}
+
+void vsm::job_list::destroy(VsmJob job)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    VsmJob_T &entry = find(job);
+    _condition.wait(lock, [&entry]()
+                    { return entry.done; });
+    _jobs.erase(job);
+}
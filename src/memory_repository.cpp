@@ -0,0 +1,349 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::memory_repository::memory_repository(bool debug_info) : _debug_info(debug_info)
+{
+}
+
+void vsm::memory_repository::record(const std::string &name)
+{
+    // keeps the state the shader had before this write, so a rollback can restore it
+    if (!_savepoints.empty())
+    {
+        const auto position = _shaders.find(name);
+        _journal.emplace_back(name, position != _shaders.end() ? std::make_unique<shader>(position->second) : nullptr);
+    }
+}
+
+std::shared_ptr<const std::vector<uint32_t>> vsm::memory_repository::intern(const digest &hash, const std::vector<uint32_t> &code)
+{
+    std::weak_ptr<const std::vector<uint32_t>> &blob = _blobs[hash];
+    std::shared_ptr<const std::vector<uint32_t>> shared = blob.lock();
+
+    if (shared == nullptr)
+    {
+        shared = std::make_shared<const std::vector<uint32_t>>(code);
+        blob = shared;
+    }
+
+    return shared;
+}
+
+void vsm::memory_repository::release(const digest &hash)
+{
+    const auto position = _blobs.find(hash);
+
+    if (position != _blobs.end() && position->second.expired())
+    {
+        _blobs.erase(position);
+    }
+}
+
+const vsm::memory_repository::shader &vsm::memory_repository::find(const std::string &name, VsmResult error) const
+{
+    const auto position = _shaders.find(name);
+
+    if (position == _shaders.end())
+    {
+        throw vsm::exception(error);
+    }
+
+    return position->second;
+}
+
+void vsm::memory_repository::begin()
+{
+    _savepoints.push_back(_journal.size());
+}
+
+void vsm::memory_repository::commit()
+{
+    _savepoints.pop_back();
+
+    // an outer transaction can still roll back what this one wrote, so the journal is kept for it
+    if (_savepoints.empty())
+    {
+        _journal.clear();
+    }
+}
+
+void vsm::memory_repository::rollback()
+{
+    const size_t savepoint = _savepoints.back();
+
+    // undone newest first, so each shader ends in the state it had at the savepoint
+    while (_journal.size() > savepoint)
+    {
+        std::pair<std::string, std::unique_ptr<shader>> &entry = _journal.back();
+        if (entry.second != nullptr)
+        {
+            _shaders[entry.first] = *entry.second;
+        }
+        else
+        {
+            _shaders.erase(entry.first);
+        }
+        _journal.pop_back();
+    }
+
+    _savepoints.pop_back();
+}
+
+void vsm::memory_repository::store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    vsm::debug_info::strip(code, stripped, debug);
+    // SHA-256 of the stripped code, so only identical code is shared
+    const digest hash = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+    std::shared_ptr<const std::vector<uint32_t>> debug_info = debug.empty() ? nullptr : std::make_shared<const std::vector<uint32_t>>(std::move(debug));
+    std::shared_ptr<const std::vector<uint32_t>> shared_reflection = reflection.empty() ? nullptr : std::make_shared<const std::vector<uint32_t>>(reflection);
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    std::shared_ptr<const std::vector<uint32_t>> shared = intern(hash, stripped);
+
+    record(name);
+    const auto position = _shaders.find(name);
+
+    if (position != _shaders.end())
+    {
+        const digest previous = position->second.hash;
+        position->second.stage = stage;
+        position->second.key = key;
+        position->second.hash = hash;
+        position->second.code = std::move(shared);
+        position->second.debug_info = std::move(debug_info);
+        position->second.reflection = std::move(shared_reflection);
+        position->second.generation++;
+        release(previous);
+    }
+    else
+    {
+        _shaders.emplace(name, shader{stage, key, hash, std::move(shared), std::move(debug_info), std::move(shared_reflection), 0, {}, {}, {}, {}});
+    }
+}
+
+bool vsm::memory_repository::replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    vsm::debug_info::strip(previous, stripped, debug);
+    const digest expected = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+    vsm::debug_info::strip(code, stripped, debug);
+    const digest hash = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    const auto position = _shaders.find(name);
+
+    if (position == _shaders.end() || position->second.hash != expected)
+    {
+        return false;
+    }
+
+    record(name);
+    position->second.code = intern(hash, stripped);
+    position->second.debug_info = debug.empty() ? nullptr : std::make_shared<const std::vector<uint32_t>>(std::move(debug));
+    position->second.reflection = reflection.empty() ? nullptr : std::make_shared<const std::vector<uint32_t>>(reflection);
+    position->second.hash = hash;
+    position->second.generation++;
+    release(expected);
+    return true;
+}
+
+uint64_t vsm::memory_repository::generation(const std::string &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    return find(name, VSM_ERROR_REPOSITORY_QUERY).generation;
+}
+
+bool vsm::memory_repository::cached(const std::string &name, const digest &key)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    const auto position = _shaders.find(name);
+
+    return position != _shaders.end() && position->second.key == key;
+}
+
+void vsm::memory_repository::store_source(const compile_request &request, const std::vector<dependency> &dependencies)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    const auto position = _shaders.find(request.name);
+
+    if (position == _shaders.end())
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+
+    record(request.name);
+    // like the sqlite repository, only shaders with dependencies keep their source
+    position->second.preamble = dependencies.empty() ? std::string() : request.preamble;
+    position->second.source = dependencies.empty() ? std::string() : request.source;
+    position->second.passes = dependencies.empty() ? std::string() : request.optimization.passes;
+    position->second.dependencies = dependencies;
+}
+
+bool vsm::memory_repository::load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    const auto position = _shaders.find(name);
+
+    if (position == _shaders.end() || position->second.dependencies.empty())
+    {
+        return false;
+    }
+
+    request.preamble = position->second.preamble;
+    request.source = position->second.source;
+    request.optimization.passes = position->second.passes;
+    dependencies = position->second.dependencies;
+    return true;
+}
+
+void vsm::memory_repository::enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    for (const auto &entry : _shaders)
+    {
+        for (const dependency &dependency : entry.second.dependencies)
+        {
+            visitor(entry.first, dependency);
+        }
+    }
+}
+
+void vsm::memory_repository::load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor)
+{
+    thread_local std::vector<uint32_t> buffer;
+    std::shared_ptr<const std::vector<uint32_t>> code;
+    std::shared_ptr<const std::vector<uint32_t>> debug_info;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        const shader &shader = find(name, VSM_ERROR_REPOSITORY_LOAD);
+        code = shader.code;
+        debug_info = shader.debug_info;
+    }
+
+    if (_debug_info && debug_info != nullptr)
+    {
+        vsm::debug_info::merge(code->data(), code->size(), debug_info->data(), debug_info->size(), buffer);
+        visitor(buffer.data(), buffer.size());
+        return;
+    }
+
+    // the reference keeps the code alive if the shader is written while the visitor runs
+    visitor(code->data(), code->size());
+}
+
+bool vsm::memory_repository::load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor)
+{
+    std::shared_ptr<const std::vector<uint32_t>> reflection;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        reflection = find(name, VSM_ERROR_REPOSITORY_LOAD).reflection;
+    }
+
+    if (reflection == nullptr)
+    {
+        return false;
+    }
+
+    visitor(reflection->data(), reflection->size() * sizeof(uint32_t));
+    return true;
+}
+
+void vsm::memory_repository::store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    for (auto &pipeline_cache : _pipeline_caches)
+    {
+        if (vsm::pipeline_cache::equal(pipeline_cache.first, key))
+        {
+            pipeline_cache.second.assign(bytes, bytes + size);
+            return;
+        }
+    }
+    _pipeline_caches.emplace_back(key, std::vector<uint8_t>(bytes, bytes + size));
+}
+
+bool vsm::memory_repository::load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    for (const auto &pipeline_cache : _pipeline_caches)
+    {
+        if (vsm::pipeline_cache::equal(pipeline_cache.first, key))
+        {
+            visitor(pipeline_cache.second.data(), pipeline_cache.second.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+std::pair<bool, VsmShaderStage> vsm::memory_repository::query(const std::string &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    return std::make_pair(true, find(name, VSM_ERROR_REPOSITORY_QUERY).stage);
+}
+
+void vsm::memory_repository::remove(const std::string &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    const auto position = _shaders.find(name);
+
+    if (position != _shaders.end())
+    {
+        const digest hash = position->second.hash;
+        record(name);
+        _shaders.erase(position);
+        release(hash);
+    }
+}
+
+void vsm::memory_repository::clear()
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    for (const auto &entry : _shaders)
+    {
+        record(entry.first);
+    }
+
+    _shaders.clear();
+    _blobs.clear();
+}
+
+void vsm::memory_repository::enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    for (const auto &entry : _shaders)
+    {
+        visitor(entry.first, entry.second.stage, entry.second.code->data(), entry.second.code->size());
+    }
+}
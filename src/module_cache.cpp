@@ -0,0 +1,148 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::module_cache::module_cache(bool enabled) : _enabled(enabled), _generation(0)
+{
+}
+
+vsm::module_cache::~module_cache()
+{
+    for (const auto &module : _modules)
+    {
+        vkDestroyShaderModule(module.second.device, module.first, module.second.allocator);
+    }
+}
+
+bool vsm::module_cache::enabled() const
+{
+    return _enabled;
+}
+
+VkShaderModule vsm::module_cache::find(VkDevice device, const std::string &name, uint64_t &generation)
+{
+    VkShaderModule result = VK_NULL_HANDLE;
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto devices = _current.find(name);
+    if (devices != _current.end())
+    {
+        const auto position = devices->second.find(device);
+        if (position != devices->second.end())
+        {
+            result = position->second;
+            _modules.at(result).references++;
+        }
+    }
+    generation = _generation;
+    return result;
+}
+
+VkShaderModule vsm::module_cache::insert(VkDevice device, const std::string &name, VkShaderModule module, const VkAllocationCallbacks *allocator, uint64_t generation)
+{
+    VkShaderModule result = module;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const bool current = generation == _generation;
+        if (current)
+        {
+            // another caller created the same module first, so share theirs and drop this one
+            VkShaderModule &shared = _current[name][device];
+            if (shared != VK_NULL_HANDLE)
+            {
+                result = shared;
+                _modules.at(result).references++;
+            }
+            else
+            {
+                shared = module;
+            }
+        }
+        if (result == module)
+        {
+            // a module that raced with a write is still tracked, so releasing it destroys it
+            _modules.emplace(module, entry{device, name, allocator, 1, current});
+        }
+    }
+    if (result != module)
+    {
+        vkDestroyShaderModule(device, module, allocator);
+    }
+    return result;
+}
+
+bool vsm::module_cache::release(VkShaderModule module)
+{
+    entry released;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto position = _modules.find(module);
+        if (position == _modules.end())
+        {
+            return false;
+        }
+        if (--position->second.references > 0)
+        {
+            return true;
+        }
+        released = std::move(position->second);
+        _modules.erase(position);
+        if (released.current)
+        {
+            const auto devices = _current.find(released.name);
+            devices->second.erase(released.device);
+            if (devices->second.empty())
+            {
+                _current.erase(devices);
+            }
+        }
+    }
+    vkDestroyShaderModule(released.device, module, released.allocator);
+    return true;
+}
+
+void vsm::module_cache::invalidate(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _generation++;
+    const auto devices = _current.find(name);
+    if (devices != _current.end())
+    {
+        // modules still in use stay alive until their last release
+        for (const auto &device : devices->second)
+        {
+            _modules.at(device.second).current = false;
+        }
+        _current.erase(devices);
+    }
+}
+
+void vsm::module_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _generation++;
+    for (auto &module : _modules)
+    {
+        module.second.current = false;
+    }
+    _current.clear();
+}
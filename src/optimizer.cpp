@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "internal.hpp"
+
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+    // the passes of spirv-opt -O, listed so each can be timed on its own
+    const char *const performance_passes =
+        "--wrap-opkill --eliminate-dead-branches --merge-return --inline-entry-points-exhaustive "
+        "--eliminate-dead-functions --eliminate-dead-code-aggressive --private-to-local "
+        "--eliminate-local-single-block --eliminate-local-single-store --eliminate-dead-code-aggressive "
+        "--scalar-replacement=100 --convert-local-access-chains --eliminate-local-single-block "
+        "--eliminate-local-single-store --eliminate-dead-code-aggressive --ssa-rewrite "
+        "--eliminate-dead-code-aggressive --ccp --eliminate-dead-code-aggressive --loop-unroll "
+        "--eliminate-dead-branches --redundancy-elimination --combine-access-chains --simplify-instructions "
+        "--scalar-replacement=100 --convert-local-access-chains --eliminate-local-single-block "
+        "--eliminate-local-single-store --eliminate-dead-code-aggressive --ssa-rewrite "
+        "--eliminate-dead-code-aggressive --vector-dce --eliminate-dead-inserts --eliminate-dead-branches "
+        "--simplify-instructions --if-conversion --copy-propagate-arrays --reduce-load-size "
+        "--eliminate-dead-code-aggressive --merge-blocks --redundancy-elimination --eliminate-dead-branches "
+        "--merge-blocks --simplify-instructions";
+
+    // the passes of spirv-opt -Os
+    const char *const size_passes =
+        "--wrap-opkill --eliminate-dead-branches --merge-return --inline-entry-points-exhaustive "
+        "--eliminate-dead-functions --private-to-local --scalar-replacement=0 --ssa-rewrite --ccp "
+        "--loop-unroll --eliminate-dead-branches --simplify-instructions --scalar-replacement=0 "
+        "--eliminate-local-single-store --if-conversion --simplify-instructions --eliminate-dead-code-aggressive "
+        "--eliminate-dead-branches --merge-blocks --convert-local-access-chains --eliminate-local-single-block "
+        "--eliminate-dead-code-aggressive --copy-propagate-arrays --vector-dce --eliminate-dead-inserts "
+        "--eliminate-dead-members --eliminate-local-single-store --merge-blocks --ssa-rewrite "
+        "--redundancy-elimination --simplify-instructions --eliminate-dead-code-aggressive --cfg-cleanup";
+
+    // runs the passes together, so the module is only parsed and written out once
+    void run_passes(spv_target_env environment, const std::vector<std::string> &passes, std::vector<uint32_t> &code)
+    {
+        std::unique_ptr<spv_optimizer_t, decltype(&spvOptimizerDestroy)> optimizer(spvOptimizerCreate(environment), spvOptimizerDestroy);
+        std::unique_ptr<spv_optimizer_options_t, decltype(&spvOptimizerOptionsDestroy)> options(spvOptimizerOptionsCreate(), spvOptimizerOptionsDestroy);
+        spv_binary binary = nullptr;
+
+        for (const std::string &pass : passes)
+        {
+            if (!spvOptimizerRegisterPassFromFlag(optimizer.get(), pass.c_str()))
+            {
+                throw vsm::exception(VSM_ERROR_COMPILE_OPTIMIZE);
+            }
+        }
+
+        // glslang's output is valid already, and validating it between timed passes would dominate
+        spvOptimizerOptionsSetRunValidator(options.get(), false);
+        if (spvOptimizerRun(optimizer.get(), code.data(), code.size(), &binary, options.get()) != SPV_SUCCESS)
+        {
+            spvBinaryDestroy(binary);
+            throw vsm::exception(VSM_ERROR_COMPILE_OPTIMIZE);
+        }
+
+        code.assign(binary->code, binary->code + binary->wordCount);
+        spvBinaryDestroy(binary);
+    }
+}
+
+vsm::optimization vsm::optimizer::configure(const VsmOptimizationInfo &optimization_info)
+{
+    optimization result = {std::string(), optimization_info.pfnTiming, optimization_info.pUserData, optimization_info.tiered == VK_TRUE};
+
+    switch (optimization_info.level)
+    {
+    case VSM_OPTIMIZATION_NONE:
+        break;
+    case VSM_OPTIMIZATION_PERFORMANCE:
+        result.passes = performance_passes;
+        break;
+    case VSM_OPTIMIZATION_SIZE:
+        result.passes = size_passes;
+        break;
+    case VSM_OPTIMIZATION_CUSTOM:
+        if (optimization_info.passCount > 0 && optimization_info.ppPasses == nullptr)
+        {
+            throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+        }
+        for (uint32_t index = 0; index < optimization_info.passCount; index++)
+        {
+            if (optimization_info.ppPasses[index] == nullptr)
+            {
+                throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+            }
+            result.passes += (index > 0 ? " " : "") + std::string(optimization_info.ppPasses[index]);
+        }
+        break;
+    default:
+        throw vsm::exception(VSM_ERROR_COMPILE_OPTIMIZE);
+    }
+
+    return result;
+}
+
+void vsm::optimizer::run(spv_target_env environment, const std::string &name, const optimization &optimization, std::vector<uint32_t> &code)
+{
+    std::istringstream stream(optimization.passes);
+    std::vector<std::string> passes;
+    std::string pass;
+
+    while (stream >> pass)
+    {
+        passes.push_back(pass);
+    }
+
+    if (optimization.timing == nullptr)
+    {
+        run_passes(environment, passes, code);
+        return;
+    }
+
+    for (const std::string &pass : passes)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        run_passes(environment, {pass}, code);
+        const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+        optimization.timing(name.c_str(), pass.c_str(), static_cast<uint64_t>(elapsed.count()), optimization.user_data);
+    }
+}
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 'VSMP', also rejects packs written with the other byte order
+static const uint32_t pack_magic = 0x504D5356;
+// version 2 added reflection records to the index
+static const uint32_t pack_version = 2;
+
+// the file is a header, the index sorted by name hash, the names, then the code and reflection records
+struct pack_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+struct pack_entry
+{
+    uint64_t hash;
+    uint64_t name_offset;
+    uint64_t code_offset;
+    uint64_t reflection_offset;
+    uint32_t name_size;
+    uint32_t code_size;
+    // in bytes, 0 for a shader without a reflection record
+    uint32_t reflection_size;
+    uint32_t stage;
+};
+
+static uint64_t name_hash(const std::string &name)
+{
+    return vsm::utilities::hash(name.data(), name.size());
+}
+
+// entries are checked when used, as a corrupt pack must not read outside the mapping
+static bool valid_entry(const pack_entry &entry, size_t size)
+{
+    return entry.name_offset <= size &&
+           entry.name_size <= size - entry.name_offset &&
+           entry.code_offset % sizeof(uint32_t) == 0 &&
+           entry.code_offset <= size &&
+           entry.code_size <= (size - entry.code_offset) / sizeof(uint32_t) &&
+           entry.reflection_offset % sizeof(uint32_t) == 0 &&
+           entry.reflection_offset <= size &&
+           entry.reflection_size <= size - entry.reflection_offset;
+}
+
+void vsm::pack_repository::write(const std::string &path, const std::vector<uint32_t> &arena, const std::unordered_map<std::string, code_location> &entries)
+{
+    std::vector<std::pair<uint64_t, const std::pair<const std::string, code_location> *>> order;
+    std::vector<pack_entry> index;
+    std::string names;
+
+    for (const auto &entry : entries)
+    {
+        order.emplace_back(name_hash(entry.first), &entry);
+    }
+    std::sort(order.begin(), order.end(), [](const auto &lhs, const auto &rhs)
+              { return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second->first < rhs.second->first; });
+
+    const uint64_t names_offset = sizeof(pack_header) + order.size() * sizeof(pack_entry);
+    for (const auto &entry : order)
+    {
+        names.append(entry.second->first);
+    }
+    // the arena is written whole, so shaders sharing code or reflection records keep sharing them
+    const uint64_t code_offset = (names_offset + names.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+    uint64_t name_offset = names_offset;
+    for (const auto &entry : order)
+    {
+        const code_location &location = entry.second->second;
+        index.push_back({entry.first,
+                         name_offset,
+                         code_offset + location.offset * sizeof(uint32_t),
+                         code_offset + location.reflection_offset * sizeof(uint32_t),
+                         static_cast<uint32_t>(entry.second->first.size()),
+                         static_cast<uint32_t>(location.size),
+                         static_cast<uint32_t>(location.reflection_size),
+                         static_cast<uint32_t>(location.stage)});
+        name_offset += entry.second->first.size();
+    }
+
+    const pack_header header = {pack_magic, pack_version, static_cast<uint32_t>(index.size()), 0, code_offset + arena.size() * sizeof(uint32_t)};
+    const std::vector<char> padding(code_offset - names_offset - names.size(), 0);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(pack_entry));
+    file.write(names.data(), names.size());
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char *>(arena.data()), arena.size() * sizeof(uint32_t));
+    file.close();
+
+    if (!file)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+}
+
+vsm::pack_repository::pack_repository(const std::string &path) : _data(nullptr), _size(0), _count(0)
+{
+#ifdef _WIN32
+    _file = INVALID_HANDLE_VALUE;
+    _mapping = nullptr;
+    LARGE_INTEGER size;
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(_file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(pack_header)))
+    {
+        release();
+        throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    _data = _mapping != nullptr ? static_cast<const uint8_t *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+    struct stat status;
+    _file = open(path.c_str(), O_RDONLY);
+    if (_file < 0 || fstat(_file, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(pack_header)))
+    {
+        release();
+        throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
+    }
+    _size = static_cast<size_t>(status.st_size);
+    void *data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, _file, 0);
+    _data = data != MAP_FAILED ? static_cast<const uint8_t *>(data) : nullptr;
+#endif
+    if (_data == nullptr)
+    {
+        release();
+        throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
+    }
+
+    // only the header is checked here, so opening does not depend on the number of shaders
+    const pack_header *header = reinterpret_cast<const pack_header *>(_data);
+    if (header->magic != pack_magic ||
+        header->version != pack_version ||
+        header->size != _size ||
+        header->count > (_size - sizeof(pack_header)) / sizeof(pack_entry))
+    {
+        release();
+        throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+    }
+    _count = header->count;
+}
+
+vsm::pack_repository::~pack_repository()
+{
+    release();
+}
+
+void vsm::pack_repository::release()
+{
+#ifdef _WIN32
+    if (_data != nullptr)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping != nullptr)
+    {
+        CloseHandle(_mapping);
+    }
+    if (_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_file);
+    }
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+#else
+    if (_data != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(_data), _size);
+    }
+    if (_file >= 0)
+    {
+        close(_file);
+    }
+    _file = -1;
+#endif
+    _data = nullptr;
+}
+
+const void *vsm::pack_repository::find(const std::string &name) const
+{
+    const pack_entry *begin = reinterpret_cast<const pack_entry *>(_data + sizeof(pack_header));
+    const pack_entry *end = begin + _count;
+    const uint64_t hash = name_hash(name);
+    const pack_entry *entry = std::lower_bound(begin, end, hash, [](const pack_entry &entry, uint64_t hash)
+                                               { return entry.hash < hash; });
+
+    for (; entry != end && entry->hash == hash; entry++)
+    {
+        if (!valid_entry(*entry, _size))
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+        if (entry->name_size == name.size() && memcmp(_data + entry->name_offset, name.data(), name.size()) == 0)
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void vsm::pack_repository::load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor)
+{
+    const pack_entry *entry = static_cast<const pack_entry *>(find(name));
+
+    if (entry == nullptr)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    visitor(reinterpret_cast<const uint32_t *>(_data + entry->code_offset), entry->code_size);
+}
+
+bool vsm::pack_repository::load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor)
+{
+    const pack_entry *entry = static_cast<const pack_entry *>(find(name));
+
+    if (entry == nullptr)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    if (entry->reflection_size == 0)
+    {
+        return false;
+    }
+
+    visitor(_data + entry->reflection_offset, entry->reflection_size);
+    return true;
+}
+
+void vsm::pack_repository::store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+// packs only hold shaders, so every device starts without pipeline cache data
+bool vsm::pack_repository::load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor)
+{
+    return false;
+}
+
+std::pair<bool, VsmShaderStage> vsm::pack_repository::query(const std::string &name)
+{
+    const pack_entry *entry = static_cast<const pack_entry *>(find(name));
+
+    if (entry == nullptr)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    return std::make_pair(true, static_cast<VsmShaderStage>(entry->stage));
+}
+
+void vsm::pack_repository::enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor)
+{
+    const pack_entry *entries = reinterpret_cast<const pack_entry *>(_data + sizeof(pack_header));
+
+    for (uint32_t index = 0; index < _count; index++)
+    {
+        const pack_entry &entry = entries[index];
+        if (!valid_entry(entry, _size))
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        }
+        visitor(std::string(reinterpret_cast<const char *>(_data + entry.name_offset), entry.name_size),
+                static_cast<VsmShaderStage>(entry.stage),
+                reinterpret_cast<const uint32_t *>(_data + entry.code_offset),
+                entry.code_size);
+    }
+}
+
+void vsm::pack_repository::begin()
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+void vsm::pack_repository::commit()
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+void vsm::pack_repository::rollback()
+{
+}
+
+void vsm::pack_repository::store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+// packs keep no compile keys, so nothing in them is current for a compile
+bool vsm::pack_repository::cached(const std::string &name, const digest &key)
+{
+    return false;
+}
+
+bool vsm::pack_repository::replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+// packs are never written, so their shaders stay at their first generation
+uint64_t vsm::pack_repository::generation(const std::string &name)
+{
+    if (!query(name).first)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+    return 0;
+}
+
+void vsm::pack_repository::store_source(const compile_request &request, const std::vector<dependency> &dependencies)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+}
+
+// a pack keeps no sources, so none of its shaders are ever stale
+bool vsm::pack_repository::load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies)
+{
+    return false;
+}
+
+void vsm::pack_repository::enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor)
+{
+}
+
+void vsm::pack_repository::remove(const std::string &name)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
+}
+
+void vsm::pack_repository::clear()
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_CLEAR);
+}
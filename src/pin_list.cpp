@@ -0,0 +1,54 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+const uint32_t *vsm::pin_list::pin(cache::shared_code code)
+{
+    const uint32_t *data = code->data();
+    std::lock_guard<std::mutex> lock(_mutex);
+    // code that is already pinned, as the same shader handed out again is, only gains a reference
+    entry &pinned = _pins[data];
+    if (pinned.code == nullptr)
+    {
+        pinned.code = std::move(code);
+        pinned.references = 0;
+    }
+    pinned.references++;
+    return data;
+}
+
+void vsm::pin_list::release(const uint32_t *code)
+{
+    // freed once the lock is dropped
+    cache::shared_code released;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto position = _pins.find(code);
+        if (position == _pins.end() || --position->second.references > 0)
+        {
+            return;
+        }
+        released = std::move(position->second.code);
+        _pins.erase(position);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::pipeline_cache_key vsm::pipeline_cache::key(const VkPhysicalDeviceProperties &properties)
+{
+    pipeline_cache_key result;
+    result.vendor_id = properties.vendorID;
+    result.device_id = properties.deviceID;
+    memcpy(result.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return result;
+}
+
+bool vsm::pipeline_cache::key(const void *data, size_t size, pipeline_cache_key &key)
+{
+    // the words of VkPipelineCacheHeaderVersionOne before the uuid, read as integers since the
+    // version may be one the enumeration does not name
+    uint32_t words[4];
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    if (data == nullptr || size < sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        return false;
+    }
+
+    // the data comes from the driver, so it is read bytewise rather than trusted to be aligned
+    memcpy(words, bytes, sizeof(words));
+
+    if (words[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || words[0] < sizeof(VkPipelineCacheHeaderVersionOne) || words[0] > size)
+    {
+        return false;
+    }
+
+    key.vendor_id = words[2];
+    key.device_id = words[3];
+    memcpy(key.uuid, bytes + sizeof(words), VK_UUID_SIZE);
+    return true;
+}
+
+bool vsm::pipeline_cache::equal(const pipeline_cache_key &left, const pipeline_cache_key &right)
+{
+    return left.vendor_id == right.vendor_id && left.device_id == right.device_id && memcmp(left.uuid, right.uuid, VK_UUID_SIZE) == 0;
+}
+
+void vsm::pipeline_cache::data(VkDevice device, VkPipelineCache cache, std::vector<uint8_t> &data)
+{
+    size_t size = 0;
+    VkResult result;
+
+    // the cache may grow between the calls, in which case the size is asked for again
+    do
+    {
+        if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS)
+        {
+            throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+        }
+        data.resize(size);
+        result = vkGetPipelineCacheData(device, cache, &size, data.data());
+    } while (result == VK_INCOMPLETE);
+
+    if (result != VK_SUCCESS)
+    {
+        throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+    }
+    data.resize(size);
+}
+
+void vsm::pipeline_cache::merge(VkDevice device, const VkAllocationCallbacks *allocator, const void *stored, size_t size, VkPipelineCache source, std::vector<uint8_t> &merged)
+{
+    const VkPipelineCacheCreateInfo create_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        nullptr,
+        0,
+        size,
+        stored};
+    VkPipelineCache cache;
+
+    if (vkCreatePipelineCache(device, &create_info, allocator, &cache) != VK_SUCCESS)
+    {
+        throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+    }
+
+    try
+    {
+        if (vkMergePipelineCaches(device, cache, 1, &source) != VK_SUCCESS)
+        {
+            throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+        }
+        data(device, cache, merged);
+    }
+    catch (...)
+    {
+        vkDestroyPipelineCache(device, cache, allocator);
+        throw;
+    }
+    vkDestroyPipelineCache(device, cache, allocator);
+}
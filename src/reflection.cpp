@@ -0,0 +1,560 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+#include <array>
+
+namespace
+{
+    const uint32_t spirv_magic = 0x07230203;
+    const size_t spirv_header_words = 5;
+    // bumped whenever the layout of the record changes
+    const uint32_t record_version = 1;
+    // version, local size, push constant offset and size, then the three counts
+    const size_t record_header_words = 9;
+    const size_t binding_words = 4;
+    const size_t variable_words = 2;
+
+    enum opcode : uint32_t
+    {
+        op_execution_mode = 16,
+        op_type_bool = 20,
+        op_type_int = 21,
+        op_type_float = 22,
+        op_type_vector = 23,
+        op_type_matrix = 24,
+        op_type_image = 25,
+        op_type_sampler = 26,
+        op_type_sampled_image = 27,
+        op_type_array = 28,
+        op_type_runtime_array = 29,
+        op_type_struct = 30,
+        op_type_pointer = 32,
+        op_constant = 43,
+        op_variable = 59,
+        op_decorate = 71,
+        op_member_decorate = 72,
+        op_type_acceleration_structure = 5341,
+    };
+
+    enum decoration : uint32_t
+    {
+        decoration_block = 2,
+        decoration_buffer_block = 3,
+        decoration_array_stride = 6,
+        decoration_matrix_stride = 7,
+        decoration_built_in = 11,
+        decoration_location = 30,
+        decoration_binding = 33,
+        decoration_descriptor_set = 34,
+        decoration_offset = 35,
+    };
+
+    enum storage_class : uint32_t
+    {
+        storage_uniform_constant = 0,
+        storage_input = 1,
+        storage_uniform = 2,
+        storage_output = 3,
+        storage_push_constant = 9,
+        storage_storage_buffer = 12,
+    };
+
+    const uint32_t execution_mode_local_size = 17;
+    const uint32_t dim_buffer = 5;
+    const uint32_t dim_subpass_data = 6;
+    const uint32_t unknown = UINT32_MAX;
+
+    struct type
+    {
+        uint32_t opcode = 0;
+        std::vector<uint32_t> operands;
+    };
+
+    struct id_decorations
+    {
+        uint32_t set = unknown;
+        uint32_t binding = unknown;
+        uint32_t location = unknown;
+        uint32_t array_stride = 0;
+        bool block = false;
+        bool buffer_block = false;
+        bool built_in = false;
+    };
+
+    struct member_decorations
+    {
+        uint32_t offset = 0;
+        uint32_t matrix_stride = 0;
+        bool built_in = false;
+    };
+
+    struct variable
+    {
+        uint32_t id;
+        uint32_t type;
+        uint32_t storage;
+    };
+
+    // the parts of a module reflection needs, indexed by id
+    struct module
+    {
+        std::unordered_map<uint32_t, type> types;
+        std::unordered_map<uint32_t, uint32_t> constants;
+        std::unordered_map<uint32_t, id_decorations> decorations;
+        std::unordered_map<uint32_t, std::vector<member_decorations>> members;
+        std::vector<variable> variables;
+        uint32_t local_size[3] = {1, 1, 1};
+
+        const type *find(uint32_t id) const
+        {
+            const auto position = types.find(id);
+            return position != types.end() ? &position->second : nullptr;
+        }
+
+        const id_decorations &decorated(uint32_t id) const
+        {
+            static const id_decorations none;
+            const auto position = decorations.find(id);
+            return position != decorations.end() ? position->second : none;
+        }
+
+        const member_decorations *member(uint32_t id, size_t index) const
+        {
+            const auto position = members.find(id);
+            return position != members.end() && index < position->second.size() ? &position->second[index] : nullptr;
+        }
+
+        // the element type under any arrays, with the number of elements they hold
+        uint32_t element(uint32_t id, uint32_t &count) const
+        {
+            count = 1;
+            for (const type *current = find(id); current != nullptr; current = find(id))
+            {
+                if (current->opcode == op_type_array && current->operands.size() >= 2)
+                {
+                    const auto length = constants.find(current->operands[1]);
+                    count *= length != constants.end() ? length->second : 1;
+                }
+                else if (current->opcode == op_type_runtime_array && !current->operands.empty())
+                {
+                    // sized when the descriptor set is allocated
+                    count = 0;
+                }
+                else
+                {
+                    break;
+                }
+                id = current->operands[0];
+            }
+            return id;
+        }
+
+        uint32_t size(uint32_t id, uint32_t matrix_stride) const
+        {
+            const type *current = find(id);
+            if (current == nullptr || current->operands.empty())
+            {
+                return 0;
+            }
+            switch (current->opcode)
+            {
+            case op_type_int:
+            case op_type_float:
+                return current->operands[0] / 8;
+            case op_type_vector:
+                return current->operands.size() >= 2 ? size(current->operands[0], 0) * current->operands[1] : 0;
+            case op_type_matrix:
+                if (current->operands.size() < 2)
+                {
+                    return 0;
+                }
+                return (matrix_stride != 0 ? matrix_stride : size(current->operands[0], 0)) * current->operands[1];
+            case op_type_array:
+            {
+                uint32_t count;
+                element(id, count);
+                return decorated(id).array_stride * count;
+            }
+            case op_type_struct:
+            {
+                uint32_t end = 0;
+                for (size_t index = 0; index < current->operands.size(); index++)
+                {
+                    const member_decorations *decorations = member(id, index);
+                    const uint32_t offset = decorations != nullptr ? decorations->offset : 0;
+                    end = std::max(end, offset + size(current->operands[index], decorations != nullptr ? decorations->matrix_stride : 0));
+                }
+                return end;
+            }
+            default:
+                return 0;
+            }
+        }
+
+        bool has_built_in(uint32_t id) const
+        {
+            const auto position = members.find(id);
+            return decorated(id).built_in ||
+                   (position != members.end() &&
+                    std::any_of(position->second.begin(), position->second.end(), [](const member_decorations &member)
+                                { return member.built_in; }));
+        }
+    };
+
+    // false if an instruction does not lie within the code
+    bool parse(const std::vector<uint32_t> &code, module &module)
+    {
+        if (code.size() < spirv_header_words || code[0] != spirv_magic)
+        {
+            return false;
+        }
+        for (size_t offset = spirv_header_words; offset < code.size();)
+        {
+            const uint32_t word_count = code[offset] >> 16;
+            if (word_count == 0 || word_count > code.size() - offset)
+            {
+                return false;
+            }
+            const uint32_t opcode = code[offset] & 0xFFFF;
+            const uint32_t *operands = &code[offset + 1];
+            const size_t operand_count = word_count - 1;
+            switch (opcode)
+            {
+            case op_execution_mode:
+                if (operand_count >= 5 && operands[1] == execution_mode_local_size)
+                {
+                    std::copy(operands + 2, operands + 5, module.local_size);
+                }
+                break;
+            case op_type_bool:
+            case op_type_int:
+            case op_type_float:
+            case op_type_vector:
+            case op_type_matrix:
+            case op_type_image:
+            case op_type_sampler:
+            case op_type_sampled_image:
+            case op_type_array:
+            case op_type_runtime_array:
+            case op_type_struct:
+            case op_type_pointer:
+            case op_type_acceleration_structure:
+                if (operand_count >= 1)
+                {
+                    module.types[operands[0]] = {opcode, std::vector<uint32_t>(operands + 1, operands + operand_count)};
+                }
+                break;
+            case op_constant:
+                if (operand_count >= 3)
+                {
+                    module.constants[operands[1]] = operands[2];
+                }
+                break;
+            case op_variable:
+                if (operand_count >= 3)
+                {
+                    module.variables.push_back({operands[1], operands[0], operands[2]});
+                }
+                break;
+            case op_decorate:
+                if (operand_count >= 2)
+                {
+                    id_decorations &decorations = module.decorations[operands[0]];
+                    const uint32_t value = operand_count >= 3 ? operands[2] : 0;
+                    switch (operands[1])
+                    {
+                    case decoration_block:
+                        decorations.block = true;
+                        break;
+                    case decoration_buffer_block:
+                        decorations.buffer_block = true;
+                        break;
+                    case decoration_array_stride:
+                        decorations.array_stride = value;
+                        break;
+                    case decoration_built_in:
+                        decorations.built_in = true;
+                        break;
+                    case decoration_location:
+                        decorations.location = value;
+                        break;
+                    case decoration_binding:
+                        decorations.binding = value;
+                        break;
+                    case decoration_descriptor_set:
+                        decorations.set = value;
+                        break;
+                    }
+                }
+                break;
+            case op_member_decorate:
+                if (operand_count >= 3)
+                {
+                    std::vector<member_decorations> &members = module.members[operands[0]];
+                    const uint32_t value = operand_count >= 4 ? operands[3] : 0;
+                    if (members.size() <= operands[1])
+                    {
+                        members.resize(operands[1] + 1);
+                    }
+                    switch (operands[2])
+                    {
+                    case decoration_offset:
+                        members[operands[1]].offset = value;
+                        break;
+                    case decoration_matrix_stride:
+                        members[operands[1]].matrix_stride = value;
+                        break;
+                    case decoration_built_in:
+                        members[operands[1]].built_in = true;
+                        break;
+                    }
+                }
+                break;
+            }
+            offset += word_count;
+        }
+        return true;
+    }
+
+    VkDescriptorType descriptor_type(const module &module, uint32_t storage, uint32_t id)
+    {
+        const type *type = module.find(id);
+        if (type == nullptr)
+        {
+            return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        }
+        switch (storage)
+        {
+        case storage_uniform:
+            return module.decorated(id).buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        case storage_storage_buffer:
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        case storage_uniform_constant:
+            switch (type->opcode)
+            {
+            case op_type_sampler:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case op_type_sampled_image:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case op_type_acceleration_structure:
+                return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+            case op_type_image:
+                // dim and sampled follow the sampled type, depth, arrayed and multisampled operands
+                if (type->operands.size() < 6)
+                {
+                    return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+                }
+                if (type->operands[1] == dim_subpass_data)
+                {
+                    return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                }
+                if (type->operands[1] == dim_buffer)
+                {
+                    return type->operands[5] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                return type->operands[5] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            break;
+        }
+        return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+
+    VkFormat format(const module &module, uint32_t id)
+    {
+        static const VkFormat float16[] = {VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT};
+        static const VkFormat float32[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+        static const VkFormat float64[] = {VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT};
+        static const VkFormat sint32[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+        static const VkFormat uint32[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+        uint32_t components = 1;
+        const type *type = module.find(id);
+        // a matrix takes one location per column, each in the format of the column
+        if (type != nullptr && type->opcode == op_type_matrix && !type->operands.empty())
+        {
+            type = module.find(type->operands[0]);
+        }
+        if (type != nullptr && type->opcode == op_type_vector && type->operands.size() >= 2)
+        {
+            components = type->operands[1];
+            type = module.find(type->operands[0]);
+        }
+        if (type == nullptr || type->operands.empty() || components < 1 || components > 4)
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+        const uint32_t width = type->operands[0];
+        if (type->opcode == op_type_float)
+        {
+            return width == 16 ? float16[components - 1] : width == 32 ? float32[components - 1] : width == 64 ? float64[components - 1] : VK_FORMAT_UNDEFINED;
+        }
+        if (type->opcode == op_type_int && width == 32 && type->operands.size() >= 2)
+        {
+            return type->operands[1] != 0 ? sint32[components - 1] : uint32[components - 1];
+        }
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    template <typename T>
+    VsmResult copy(const uint8_t *source, uint32_t total, uint32_t &count, T *destination)
+    {
+        if (destination == nullptr)
+        {
+            count = total;
+            return VSM_SUCCESS;
+        }
+        count = std::min(count, total);
+        for (uint32_t index = 0; index < count; index++)
+        {
+            memcpy(&destination[index], source + index * sizeof(T), sizeof(T));
+        }
+        return count < total ? VSM_INCOMPLETE : VSM_SUCCESS;
+    }
+}
+
+void vsm::reflection::reflect(const std::vector<uint32_t> &code, std::vector<uint32_t> &record)
+{
+    std::vector<std::array<uint32_t, binding_words>> bindings;
+    std::vector<std::array<uint32_t, variable_words>> inputs;
+    std::vector<std::array<uint32_t, variable_words>> outputs;
+    uint32_t push_constant_offset = 0;
+    uint32_t push_constant_end = 0;
+    module module;
+
+    // code that is not SPIR-V has no record
+    record.clear();
+    if (!parse(code, module))
+    {
+        return;
+    }
+
+    for (const variable &variable : module.variables)
+    {
+        const type *pointer = module.find(variable.type);
+        if (pointer == nullptr || pointer->opcode != op_type_pointer || pointer->operands.size() < 2)
+        {
+            continue;
+        }
+        uint32_t count;
+        const uint32_t pointee = pointer->operands[1];
+        const uint32_t element = module.element(pointee, count);
+        const id_decorations &decorations = module.decorated(variable.id);
+        switch (variable.storage)
+        {
+        case storage_uniform_constant:
+        case storage_uniform:
+        case storage_storage_buffer:
+        {
+            const VkDescriptorType type = descriptor_type(module, variable.storage, element);
+            if (type != VK_DESCRIPTOR_TYPE_MAX_ENUM && decorations.binding != unknown)
+            {
+                bindings.push_back({decorations.set != unknown ? decorations.set : 0, decorations.binding, static_cast<uint32_t>(type), count});
+            }
+            break;
+        }
+        case storage_push_constant:
+        {
+            const type *block = module.find(pointee);
+            if (block != nullptr && block->opcode == op_type_struct)
+            {
+                // the range starts at the first member, which is not always at offset zero
+                push_constant_offset = block->operands.empty() ? 0 : UINT32_MAX;
+                for (size_t index = 0; index < block->operands.size(); index++)
+                {
+                    const member_decorations *member = module.member(pointee, index);
+                    push_constant_offset = std::min(push_constant_offset, member != nullptr ? member->offset : 0);
+                }
+                push_constant_end = module.size(pointee, 0);
+            }
+            break;
+        }
+        case storage_input:
+        case storage_output:
+            // built in variables and blocks such as gl_PerVertex take no location
+            if (decorations.location != unknown && !module.has_built_in(variable.id) && !module.has_built_in(element))
+            {
+                (variable.storage == storage_input ? inputs : outputs).push_back({decorations.location, static_cast<uint32_t>(format(module, element))});
+            }
+            break;
+        }
+    }
+
+    std::sort(bindings.begin(), bindings.end());
+    std::sort(inputs.begin(), inputs.end());
+    std::sort(outputs.begin(), outputs.end());
+    // push constant ranges are a multiple of four bytes
+    const uint32_t push_constant_size = ((push_constant_end - push_constant_offset) + 3) & ~3u;
+
+    record = {record_version,
+              module.local_size[0],
+              module.local_size[1],
+              module.local_size[2],
+              push_constant_offset,
+              push_constant_size,
+              static_cast<uint32_t>(bindings.size()),
+              static_cast<uint32_t>(inputs.size()),
+              static_cast<uint32_t>(outputs.size())};
+    for (const auto &binding : bindings)
+    {
+        record.insert(record.end(), binding.begin(), binding.end());
+    }
+    for (const auto &input : inputs)
+    {
+        record.insert(record.end(), input.begin(), input.end());
+    }
+    for (const auto &output : outputs)
+    {
+        record.insert(record.end(), output.begin(), output.end());
+    }
+}
+
+VsmResult vsm::reflection::read(const void *data, size_t size, VsmShaderReflection &reflection)
+{
+    static_assert(sizeof(VsmShaderBinding) == binding_words * sizeof(uint32_t), "bindings are copied as they are recorded");
+    static_assert(sizeof(VsmShaderInterfaceVariable) == variable_words * sizeof(uint32_t), "variables are copied as they are recorded");
+    // the record may lie unaligned in a database row, so it is read bytewise where it lies
+    const uint8_t *record = static_cast<const uint8_t *>(data);
+    uint32_t header[record_header_words];
+
+    if (size < sizeof(header))
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+    memcpy(header, data, sizeof(header));
+    const uint64_t words = record_header_words + static_cast<uint64_t>(header[6]) * binding_words + (static_cast<uint64_t>(header[7]) + header[8]) * variable_words;
+    if (header[0] != record_version || size != words * sizeof(uint32_t))
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    std::copy(header + 1, header + 4, reflection.localSize);
+    reflection.pushConstantOffset = header[4];
+    reflection.pushConstantSize = header[5];
+    const uint8_t *bindings = record + sizeof(header);
+    const uint8_t *inputs = bindings + header[6] * sizeof(VsmShaderBinding);
+    const uint8_t *outputs = inputs + header[7] * sizeof(VsmShaderInterfaceVariable);
+    const VsmResult binding_result = copy(bindings, header[6], reflection.bindingCount, reflection.pBindings);
+    const VsmResult input_result = copy(inputs, header[7], reflection.inputCount, reflection.pInputs);
+    const VsmResult output_result = copy(outputs, header[8], reflection.outputCount, reflection.pOutputs);
+    return binding_result != VSM_SUCCESS ? binding_result : input_result != VSM_SUCCESS ? input_result : output_result;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+vsm::registry::~registry()
+{
+}
+
+void vsm::registry::reset(VsmShader shader)
+{
+    std::lock_guard<std::mutex> lock(shader->mutex);
+    shader->generation++;
+    shader->resolved = false;
+    shader->code.reset();
+}
+
+VsmShader vsm::registry::get(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<VsmShader_T> &shader = _shaders[name];
+    if (shader == nullptr)
+    {
+        shader.reset(new VsmShader_T);
+        shader->name = name;
+        shader->generation = 0;
+        shader->resolved = false;
+        shader->stage = VSM_SHADER_MAX_ENUM;
+    }
+    return shader.get();
+}
+
+VsmShaderStage vsm::registry::query(VsmShader shader, repository &repository)
+{
+    std::unique_lock<std::mutex> lock(shader->mutex);
+    if (!shader->resolved)
+    {
+        // the repository is read unlocked, so the result is only kept if no write happened meanwhile
+        const uint64_t generation = shader->generation;
+        lock.unlock();
+        const VsmShaderStage stage = repository.query(shader->name).second;
+        lock.lock();
+        if (generation != shader->generation)
+        {
+            return stage;
+        }
+        shader->stage = stage;
+        shader->resolved = true;
+    }
+    return shader->stage;
+}
+
+vsm::cache::shared_code vsm::registry::load(VsmShader shader, repository &repository)
+{
+    std::unique_lock<std::mutex> lock(shader->mutex);
+    if (shader->code == nullptr)
+    {
+        const uint64_t generation = shader->generation;
+        cache::shared_code code;
+        lock.unlock();
+        repository.load(shader->name, [&code](const uint32_t *data, size_t size)
+                        { code = std::make_shared<const std::vector<uint32_t>>(data, data + size); });
+        lock.lock();
+        if (generation != shader->generation)
+        {
+            return code;
+        }
+        shader->code = std::move(code);
+    }
+    return shader->code;
+}
+
+vsm::cache::shared_code vsm::registry::load(VsmShader shader, repository &repository, VsmShaderStage &stage)
+{
+    std::unique_lock<std::mutex> lock(shader->mutex);
+    if (shader->code == nullptr || !shader->resolved)
+    {
+        const uint64_t generation = shader->generation;
+        cache::shared_code code;
+        uint64_t written;
+        lock.unlock();
+        // the code and stage are separate reads, so they are read again until no write came between them
+        do
+        {
+            try
+            {
+                written = repository.generation(shader->name);
+            }
+            catch (vsm::exception &)
+            {
+                // a shader that is not stored fails as it would to load its code alone
+                throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+            }
+            repository.load(shader->name, [&code](const uint32_t *data, size_t size)
+                            { code = std::make_shared<const std::vector<uint32_t>>(data, data + size); });
+            stage = repository.query(shader->name).second;
+        } while (written != repository.generation(shader->name));
+        lock.lock();
+        if (generation != shader->generation)
+        {
+            return code;
+        }
+        shader->code = std::move(code);
+        shader->stage = stage;
+        shader->resolved = true;
+    }
+    stage = shader->stage;
+    return shader->code;
+}
+
+void vsm::registry::invalidate(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto position = _shaders.find(name);
+    if (position != _shaders.end())
+    {
+        reset(position->second.get());
+    }
+}
+
+void vsm::registry::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &shader : _shaders)
+    {
+        reset(shader.second.get());
+    }
+}
@@ -22,159 +22,112 @@
 
 #include "internal.hpp"
 
-std::unique_ptr<sqlite3, decltype(&sqlite3_close)> vsm::repository::open_db(const std::string &path, bool shared)
+std::unique_ptr<vsm::repository> vsm::repository::create(VsmRepositoryFormat format, const std::string &path, bool shared, VsmCodeEncoding encoding, bool debug_info)
 {
-    int mutex_flags = shared ? SQLITE_OPEN_FULLMUTEX : SQLITE_OPEN_NOMUTEX;
-    int open_flags = SQLITE_OPEN_READWRITE;
-    sqlite3 *db;
-    const char *filename = path.c_str();
-
-    // attempt to create new database
-    if (path.empty() && !std::filesystem::exists(path))
-    {
-        open_flags |= SQLITE_OPEN_CREATE;
-    }
-
-    if (path.empty())
-    {
-        filename = ":memory:";
-    }
-
-    if (sqlite3_open_v2(filename, &db, open_flags, nullptr) != SQLITE_OK)
-    {
+    switch (format)
+    {
+    case VSM_REPOSITORY_FORMAT_SQLITE:
+        return std::make_unique<sqlite_repository>(path, shared, encoding, debug_info);
+    case VSM_REPOSITORY_FORMAT_PACK:
+        return std::make_unique<pack_repository>(path);
+    case VSM_REPOSITORY_FORMAT_MEMORY:
+        return std::make_unique<memory_repository>(debug_info);
+    default:
         throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
     }
-    
-    return std::move(std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(db, sqlite3_close));
 }
 
-void vsm::repository::init_db(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db)
+vsm::repository::transaction::transaction(repository &repository) : _repository(repository), _lock(repository._mutex), _committed(false)
 {
-    char *err_msg = nullptr;
-    static const std::string sql = "CREATE TABLE IF NOT EXISTS shaders (name TEXT NOT NULL, stage INTEGER NOT NULL, code BLOB NOT NULL);"
-                                   "CREATE UNIQUE INDEX IF NOT EXISTS shader_index ON shaders(name);";
+    _repository.begin();
+}
 
-    if (sqlite3_exec(db.get(), sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+vsm::repository::transaction::~transaction()
+{
+    if (!_committed)
     {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+        _repository.rollback();
     }
 }
 
-vsm::repository::repository(const std::string &path, bool shared) : _db(open_db(path, shared))
+void vsm::repository::transaction::commit()
 {
-    init_db(_db);
+    _repository.commit();
+    _committed = true;
 }
 
-void vsm::repository::store(const std::string &name, VsmShaderStage stage, const std::vector<uint32_t> &code)
+void vsm::repository::load(const std::string &name, std::vector<uint32_t> &code)
 {
-    sqlite3_stmt *stmt;
-    static const std::string sql = "INSERT OR REPLACE INTO shaders (name, stage, code) VALUES (?, ?, ?);";
-
-    if (sqlite3_prepare_v2(_db.get(), sql.c_str(), sql.size(), &stmt, nullptr) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
-    }
-
-    if (sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
-        sqlite3_bind_int(stmt, 2, stage) != SQLITE_OK ||
-        sqlite3_bind_blob(stmt, 3, code.data(), code.size() * sizeof(uint32_t), SQLITE_STATIC) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
-    }
-
-    if (sqlite3_step(stmt) != SQLITE_DONE)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
-    }
-
-    sqlite3_finalize(stmt);
+    load(name, [&code](const uint32_t *data, size_t size)
+         { code.assign(data, data + size); });
 }
 
-void vsm::repository::load(const std::string &name, std::vector<uint32_t> &code)
+void vsm::repository::load(const std::vector<std::string> &names, function_ref<void(size_t, const uint32_t *, size_t)> visitor)
 {
-    sqlite3_stmt *stmt;
-    static const std::string sql = "SELECT code FROM shaders WHERE name = ?;";
-
-    if (sqlite3_prepare_v2(_db.get(), sql.c_str(), sql.size(), &stmt, nullptr) != SQLITE_OK)
+    for (size_t index = 0; index < names.size(); index++)
     {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+        try
+        {
+            load(names[index], [&](const uint32_t *code, size_t size)
+                 { visitor(index, code, size); });
+        }
+        catch (vsm::exception &)
+        {
+        }
     }
-
-    if (sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
-    }
-
-    if (sqlite3_step(stmt) != SQLITE_ROW)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
-    }
-
-    const void *data = sqlite3_column_blob(stmt, 0);
-    int size = sqlite3_column_bytes(stmt, 0) / sizeof(uint32_t);
-
-    code.resize(size);
-    memcpy(code.data(), data, size * sizeof(uint32_t));
-
-    sqlite3_finalize(stmt);
 }
 
-std::pair<bool, VsmShaderStage> vsm::repository::query(const std::string &name)
+void vsm::repository::collect(std::vector<uint32_t> &arena, std::unordered_map<std::string, code_location> &entries, bool reflection)
 {
-    sqlite3_stmt *stmt;
-    static const std::string sql = "SELECT stage FROM shaders WHERE name = ?;";
-
-    if (sqlite3_prepare_v2(_db.get(), sql.c_str(), sql.size(), &stmt, nullptr) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
-    }
-
-    if (sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    // keyed by SHA-256, so only identical code shares a location in the arena
+    std::unordered_map<digest, code_location, digest::hasher> blobs;
+    std::unordered_map<digest, size_t, digest::hasher> records;
+    // a write between reading the code and the records would pair them wrongly
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    enumerate([&](const std::string &name, VsmShaderStage stage, const uint32_t *code, size_t size)
+              {
+                  const digest hash = vsm::sha256::of(code, size * sizeof(uint32_t));
+                  auto blob = blobs.find(hash);
+                  if (blob == blobs.end())
+                  {
+                      blob = blobs.emplace(hash, code_location{arena.size(), size, stage, 0, 0}).first;
+                      arena.insert(arena.end(), code, code + size);
+                  }
+                  entries[name] = {blob->second.offset, blob->second.size, stage, 0, 0}; });
+
+    if (!reflection)
+    {
+        return;
+    }
+
+    // records are read once enumeration is done, as a backend may still be stepping through its shaders
+    for (auto &entry : entries)
+    {
+        load_reflection(entry.first, [&](const void *data, size_t size)
+                        {
+                            const digest hash = vsm::sha256::of(data, size);
+                            auto record = records.find(hash);
+                            if (record == records.end())
+                            {
+                                record = records.emplace(hash, arena.size()).first;
+                                arena.resize(arena.size() + (size + sizeof(uint32_t) - 1) / sizeof(uint32_t), 0);
+                                memcpy(arena.data() + record->second, data, size);
+                            }
+                            entry.second.reflection_offset = record->second;
+                            entry.second.reflection_size = size; });
     }
-
-    if (sqlite3_step(stmt) != SQLITE_ROW)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
-    }
-
-    VsmShaderStage stage = static_cast<VsmShaderStage>(sqlite3_column_int(stmt, 0));
-
-    sqlite3_finalize(stmt);
-
-    return std::make_pair(true, stage);
 }
 
-void vsm::repository::remove(const std::string &name)
+void vsm::repository::preload()
 {
-    sqlite3_stmt *stmt;
-    static const std::string sql = "DELETE FROM shaders WHERE name = ?;";
-
-    if (sqlite3_prepare_v2(_db.get(), sql.c_str(), sql.size(), &stmt, nullptr) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
-    }
-
-    if (sqlite3_bind_text(stmt, 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
-    }
-
-    if (sqlite3_step(stmt) != SQLITE_DONE)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
-    }
-
-    sqlite3_finalize(stmt);
 }
 
-void vsm::repository::clear()
+void vsm::repository::export_pack(const std::string &path)
 {
-    static const std::string sql = "DELETE FROM shaders;";
+    std::vector<uint32_t> arena;
+    std::unordered_map<std::string, code_location> entries;
 
-    if (sqlite3_exec(_db.get(), sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
-    {
-        throw vsm::exception(VSM_ERROR_REPOSITORY_CLEAR);
-    }
+    collect(arena, entries, true);
+    pack_repository::write(path, arena, entries);
 }
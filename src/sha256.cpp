@@ -0,0 +1,152 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t rotate(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+vsm::sha256::sha256() : _state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}, _block{}, _used(0), _size(0)
+{
+}
+
+void vsm::sha256::compress()
+{
+    uint32_t words[64];
+    for (size_t index = 0; index < 16; index++)
+    {
+        words[index] = static_cast<uint32_t>(_block[index * 4]) << 24 | static_cast<uint32_t>(_block[index * 4 + 1]) << 16 |
+                       static_cast<uint32_t>(_block[index * 4 + 2]) << 8 | static_cast<uint32_t>(_block[index * 4 + 3]);
+    }
+    for (size_t index = 16; index < 64; index++)
+    {
+        const uint32_t s0 = rotate(words[index - 15], 7) ^ rotate(words[index - 15], 18) ^ (words[index - 15] >> 3);
+        const uint32_t s1 = rotate(words[index - 2], 17) ^ rotate(words[index - 2], 19) ^ (words[index - 2] >> 10);
+        words[index] = words[index - 16] + s0 + words[index - 7] + s1;
+    }
+    uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3], e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+    for (size_t index = 0; index < 64; index++)
+    {
+        const uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + round_constants[index] + words[index];
+        const uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    _state[0] += a;
+    _state[1] += b;
+    _state[2] += c;
+    _state[3] += d;
+    _state[4] += e;
+    _state[5] += f;
+    _state[6] += g;
+    _state[7] += h;
+}
+
+void vsm::sha256::update(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    _size += size;
+    while (size > 0)
+    {
+        const size_t count = std::min(size, sizeof(_block) - _used);
+        memcpy(_block + _used, bytes, count);
+        _used += count;
+        bytes += count;
+        size -= count;
+        if (_used == sizeof(_block))
+        {
+            compress();
+            _used = 0;
+        }
+    }
+}
+
+vsm::digest vsm::sha256::finish()
+{
+    const uint64_t bits = _size * 8;
+    const uint8_t padding = 0x80;
+    const uint8_t zero = 0;
+    uint8_t length[8];
+    digest result;
+
+    update(&padding, 1);
+    while (_used != sizeof(_block) - sizeof(length))
+    {
+        update(&zero, 1);
+    }
+    for (size_t index = 0; index < sizeof(length); index++)
+    {
+        length[index] = static_cast<uint8_t>(bits >> (56 - index * 8));
+    }
+    update(length, sizeof(length));
+    for (size_t index = 0; index < 8; index++)
+    {
+        result.bytes[index * 4] = static_cast<uint8_t>(_state[index] >> 24);
+        result.bytes[index * 4 + 1] = static_cast<uint8_t>(_state[index] >> 16);
+        result.bytes[index * 4 + 2] = static_cast<uint8_t>(_state[index] >> 8);
+        result.bytes[index * 4 + 3] = static_cast<uint8_t>(_state[index]);
+    }
+    return result;
+}
+
+bool vsm::digest::operator==(const digest &other) const
+{
+    return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+bool vsm::digest::operator!=(const digest &other) const
+{
+    return !(*this == other);
+}
+
+vsm::digest vsm::sha256::of(const void *data, size_t size)
+{
+    sha256 hash;
+    hash.update(data, size);
+    return hash.finish();
+}
+
+size_t vsm::digest::hasher::operator()(const digest &value) const
+{
+    size_t result;
+    memcpy(&result, value.bytes, sizeof(result));
+    return result;
+}
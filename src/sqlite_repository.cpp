@@ -0,0 +1,1028 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+// milliseconds a connection waits on a lock held by another connection
+static const int busy_timeout = 5000;
+
+static const char *const load_source_sql = "SELECT preamble, source, passes FROM sources WHERE name = ?;";
+static const char *const load_dependencies_sql = "SELECT header, hash FROM dependencies WHERE name = ?;";
+static const char *const cached_sql = "SELECT 1 FROM shaders WHERE name = ? AND compile_digest = ?;";
+static const char *const load_reflection_sql = "SELECT blobs.reflection FROM shaders JOIN blobs ON blobs.digest = shaders.digest WHERE shaders.name = ?;";
+
+// release loads only read the stripped code, debug loads also read the shader's debug instructions
+static const char *load_sql(bool debug_info)
+{
+    return debug_info ? "SELECT blobs.code, debug_info.code FROM shaders JOIN blobs ON blobs.digest = shaders.digest "
+                        "LEFT JOIN debug_info ON debug_info.name = shaders.name WHERE shaders.name = ?;"
+                      : "SELECT blobs.code FROM shaders JOIN blobs ON blobs.digest = shaders.digest WHERE shaders.name = ?;";
+}
+
+std::unique_ptr<sqlite3, decltype(&sqlite3_close)> vsm::sqlite_repository::open_db(const std::string &path, bool shared)
+{
+    int mutex_flags = shared ? SQLITE_OPEN_FULLMUTEX : SQLITE_OPEN_NOMUTEX;
+    int open_flags = SQLITE_OPEN_READWRITE;
+    sqlite3 *db;
+    const char *filename = path.c_str();
+
+    // attempt to create new database
+    if (path.empty() || !std::filesystem::exists(path))
+    {
+        open_flags |= SQLITE_OPEN_CREATE;
+    }
+
+    if (path.empty())
+    {
+        filename = ":memory:";
+    }
+
+    if (sqlite3_open_v2(filename, &db, open_flags | mutex_flags, nullptr) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
+    }
+
+    sqlite3_busy_timeout(db, busy_timeout);
+
+    return std::move(std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(db, sqlite3_close));
+}
+
+void vsm::sqlite_repository::init_db(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db)
+{
+    char *err_msg = nullptr;
+    static const std::string sql = "CREATE TABLE IF NOT EXISTS shaders (name TEXT NOT NULL, stage INTEGER NOT NULL, code BLOB NOT NULL);"
+                                   "CREATE UNIQUE INDEX IF NOT EXISTS shader_index ON shaders(name);";
+
+    if (sqlite3_exec(db.get(), sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+    }
+
+    // lets migrations address existing code by the same hash and digest the repository used
+    if (sqlite3_create_function_v2(db.get(), "vsm_hash", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, hash_function, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_create_function_v2(db.get(), "vsm_digest", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, digest_function, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_create_function_v2(db.get(), "vsm_strip", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, strip_function, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_create_function_v2(db.get(), "vsm_debug", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, debug_function, nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+    }
+
+    migrate_db(db);
+}
+
+void vsm::sqlite_repository::hash_function(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    sqlite3_result_int64(context, static_cast<sqlite3_int64>(vsm::utilities::hash(sqlite3_value_blob(argv[0]), sqlite3_value_bytes(argv[0]))));
+}
+
+// the code of a stored blob split into its stripped code and debug instructions
+static void split_blob(sqlite3_value *value, std::vector<uint32_t> &stripped, std::vector<uint32_t> &debug)
+{
+    const void *data = sqlite3_value_blob(value);
+    const size_t size = sqlite3_value_bytes(value);
+    std::vector<uint32_t> code;
+
+    if (vsm::encoding::is_encoded(data, size))
+    {
+        vsm::encoding::decode(data, size, code);
+    }
+    else
+    {
+        code.resize(size / sizeof(uint32_t));
+        memcpy(code.data(), data, code.size() * sizeof(uint32_t));
+    }
+    vsm::debug_info::strip(code, stripped, debug);
+}
+
+void vsm::sqlite_repository::digest_function(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    split_blob(argv[0], stripped, debug);
+    const digest hash = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+    sqlite3_result_blob(context, hash.bytes, sizeof(hash.bytes), SQLITE_TRANSIENT);
+}
+
+void vsm::sqlite_repository::strip_function(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    split_blob(argv[0], stripped, debug);
+    // code without debug instructions keeps its encoding
+    if (debug.empty())
+    {
+        sqlite3_result_value(context, argv[0]);
+        return;
+    }
+    sqlite3_result_blob(context, stripped.data(), stripped.size() * sizeof(uint32_t), SQLITE_TRANSIENT);
+}
+
+void vsm::sqlite_repository::debug_function(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    split_blob(argv[0], stripped, debug);
+    if (debug.empty())
+    {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_blob(context, debug.data(), debug.size() * sizeof(uint32_t), SQLITE_TRANSIENT);
+}
+
+void vsm::sqlite_repository::migrate_db(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db)
+{
+    // each entry upgrades the schema by one version, tracked in user_version
+    static const std::vector<std::string> migrations = {
+        "ALTER TABLE shaders ADD COLUMN compile_key INTEGER;",
+        // code moves to a content addressed table, reference counted by triggers on shaders
+        "CREATE TABLE blobs (hash INTEGER PRIMARY KEY, refs INTEGER NOT NULL, code BLOB NOT NULL);"
+        // each distinct code gets one row, so different code with the same hash fails the migration
+        "INSERT INTO blobs (hash, refs, code) SELECT vsm_hash(code), 0, code FROM shaders GROUP BY code;"
+        "CREATE TABLE shaders_v2 (name TEXT NOT NULL, stage INTEGER NOT NULL, compile_key INTEGER, hash INTEGER NOT NULL);"
+        "INSERT INTO shaders_v2 (name, stage, compile_key, hash) SELECT name, stage, compile_key, vsm_hash(code) FROM shaders;"
+        "UPDATE blobs SET refs = (SELECT COUNT(*) FROM shaders_v2 WHERE shaders_v2.hash = blobs.hash);"
+        "DROP TABLE shaders;"
+        "ALTER TABLE shaders_v2 RENAME TO shaders;"
+        "CREATE UNIQUE INDEX shader_index ON shaders(name);"
+        "CREATE TRIGGER shader_insert AFTER INSERT ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs + 1 WHERE hash = NEW.hash; END;"
+        "CREATE TRIGGER shader_update AFTER UPDATE OF hash ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs + 1 WHERE hash = NEW.hash;"
+        "UPDATE blobs SET refs = refs - 1 WHERE hash = OLD.hash;"
+        "DELETE FROM blobs WHERE hash = OLD.hash AND refs = 0; END;"
+        "CREATE TRIGGER shader_delete AFTER DELETE ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs - 1 WHERE hash = OLD.hash;"
+        "DELETE FROM blobs WHERE hash = OLD.hash AND refs = 0; END;",
+        // sources and included headers of shaders that have them, forgotten with the shader
+        "CREATE TABLE sources (name TEXT PRIMARY KEY, source TEXT NOT NULL);"
+        "CREATE TABLE dependencies (name TEXT NOT NULL, header TEXT NOT NULL, hash INTEGER NOT NULL, PRIMARY KEY (name, header));"
+        "CREATE INDEX dependency_index ON dependencies(header);"
+        "CREATE TRIGGER shader_delete_source AFTER DELETE ON shaders BEGIN "
+        "DELETE FROM sources WHERE name = OLD.name;"
+        "DELETE FROM dependencies WHERE name = OLD.name; END;",
+        "ALTER TABLE sources ADD COLUMN preamble TEXT NOT NULL DEFAULT '';",
+        "ALTER TABLE sources ADD COLUMN passes TEXT NOT NULL DEFAULT '';",
+        "ALTER TABLE shaders ADD COLUMN generation INTEGER NOT NULL DEFAULT 0;",
+        // debug instructions stripped from each shader's code, forgotten with the shader
+        "CREATE TABLE debug_info (name TEXT PRIMARY KEY, code BLOB NOT NULL);"
+        "CREATE TRIGGER shader_delete_debug_info AFTER DELETE ON shaders BEGIN "
+        "DELETE FROM debug_info WHERE name = OLD.name; END;",
+        // reflection data of the code, NULL for code stored before it was recorded
+        "ALTER TABLE blobs ADD COLUMN reflection BLOB;",
+        // driver pipeline cache data, one blob per device and driver build
+        "CREATE TABLE pipeline_caches (vendor_id INTEGER NOT NULL, device_id INTEGER NOT NULL, uuid BLOB NOT NULL, data BLOB NOT NULL, "
+        "PRIMARY KEY (vendor_id, device_id, uuid));",
+        // SHA-256 compile keys replace the 64-bit compile_key, which is no longer written, so shaders recompile once
+        "ALTER TABLE shaders ADD COLUMN compile_digest BLOB;",
+        // blobs are keyed by the SHA-256 digest of their stripped code, as stores key them, so blobs
+        // from before debug instructions were kept apart share rows with new ones. Their debug
+        // instructions move to debug_info, and code that loses some is kept raw.
+        "INSERT OR IGNORE INTO debug_info (name, code) SELECT shaders.name, vsm_debug(blobs.code) FROM shaders "
+        "JOIN blobs ON blobs.hash = shaders.hash WHERE vsm_debug(blobs.code) IS NOT NULL;"
+        "CREATE TABLE blobs_v2 (digest BLOB PRIMARY KEY, refs INTEGER NOT NULL, code BLOB NOT NULL, reflection BLOB);"
+        "INSERT INTO blobs_v2 (digest, refs, code, reflection) SELECT vsm_digest(code), 0, vsm_strip(code), reflection FROM blobs WHERE true "
+        "ON CONFLICT(digest) DO UPDATE SET reflection = excluded.reflection WHERE blobs_v2.reflection IS NULL;"
+        "CREATE TABLE shaders_v3 (name TEXT NOT NULL, stage INTEGER NOT NULL, compile_key INTEGER, compile_digest BLOB, "
+        "generation INTEGER NOT NULL DEFAULT 0, digest BLOB NOT NULL);"
+        "INSERT INTO shaders_v3 (name, stage, compile_key, compile_digest, generation, digest) "
+        "SELECT shaders.name, shaders.stage, shaders.compile_key, shaders.compile_digest, shaders.generation, vsm_digest(blobs.code) "
+        "FROM shaders JOIN blobs ON blobs.hash = shaders.hash;"
+        "UPDATE blobs_v2 SET refs = (SELECT COUNT(*) FROM shaders_v3 WHERE shaders_v3.digest = blobs_v2.digest);"
+        "DROP TABLE shaders;"
+        "DROP TABLE blobs;"
+        "ALTER TABLE shaders_v3 RENAME TO shaders;"
+        "ALTER TABLE blobs_v2 RENAME TO blobs;"
+        "CREATE UNIQUE INDEX shader_index ON shaders(name);"
+        "CREATE TRIGGER shader_insert AFTER INSERT ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs + 1 WHERE digest = NEW.digest; END;"
+        "CREATE TRIGGER shader_update AFTER UPDATE OF digest ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs + 1 WHERE digest = NEW.digest;"
+        "UPDATE blobs SET refs = refs - 1 WHERE digest = OLD.digest;"
+        "DELETE FROM blobs WHERE digest = OLD.digest AND refs = 0; END;"
+        "CREATE TRIGGER shader_delete AFTER DELETE ON shaders BEGIN "
+        "UPDATE blobs SET refs = refs - 1 WHERE digest = OLD.digest;"
+        "DELETE FROM blobs WHERE digest = OLD.digest AND refs = 0; END;"
+        "CREATE TRIGGER shader_delete_source AFTER DELETE ON shaders BEGIN "
+        "DELETE FROM sources WHERE name = OLD.name;"
+        "DELETE FROM dependencies WHERE name = OLD.name; END;"
+        "CREATE TRIGGER shader_delete_debug_info AFTER DELETE ON shaders BEGIN "
+        "DELETE FROM debug_info WHERE name = OLD.name; END;",
+    };
+    statement version_stmt = prepare(db, "PRAGMA user_version;", VSM_ERROR_REPOSITORY_INIT);
+
+    if (sqlite3_step(version_stmt.get()) != SQLITE_ROW)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+    }
+
+    const size_t current = sqlite3_column_int(version_stmt.get(), 0);
+    // an active statement would keep the schema locked
+    version_stmt.reset();
+
+    for (size_t version = current; version < migrations.size(); version++)
+    {
+        const std::string sql = "BEGIN;" + migrations[version] + "PRAGMA user_version = " + std::to_string(version + 1) + ";COMMIT;";
+        if (sqlite3_exec(db.get(), sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            sqlite3_exec(db.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+            throw vsm::exception(VSM_ERROR_REPOSITORY_INIT);
+        }
+    }
+}
+
+vsm::sqlite_repository::statement vsm::sqlite_repository::prepare(std::unique_ptr<sqlite3, decltype(&sqlite3_close)> &db, const std::string &sql, VsmResult error)
+{
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v3(db.get(), sql.c_str(), sql.size(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        throw vsm::exception(error);
+    }
+
+    return statement(stmt, sqlite3_finalize);
+}
+
+vsm::sqlite_repository::sqlite_repository(const std::string &path, bool shared, VsmCodeEncoding encoding, bool debug_info) : _db(open_db(path, shared)),
+                                                                                                            _store_blob_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _store_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _store_source_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _store_dependency_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _remove_source_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _remove_dependencies_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _load_source_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _load_dependencies_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _cached_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _replace_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _generation_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _store_debug_info_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _remove_debug_info_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _load_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _load_reflection_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _store_pipeline_cache_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _load_pipeline_cache_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _query_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _remove_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _clear_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _begin_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _commit_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _rollback_stmt(nullptr, sqlite3_finalize),
+                                                                                                            _encoding(encoding),
+                                                                                                            _debug_info(debug_info),
+                                                                                                            _path(path),
+                                                                                                            _pooled(false)
+{
+    init_db(_db);
+    // in memory databases are private to their connection, so they keep the single connection
+    if (shared && !path.empty())
+    {
+        statement wal_stmt = prepare(_db, "PRAGMA journal_mode = WAL;", VSM_ERROR_REPOSITORY_INIT);
+        _pooled = sqlite3_step(wal_stmt.get()) == SQLITE_ROW &&
+                  sqlite3_stricmp(reinterpret_cast<const char *>(sqlite3_column_text(wal_stmt.get(), 0)), "wal") == 0;
+    }
+    // storing code that is already present only writes the shader row, and the reflection data if the code has none
+    _store_blob_stmt = prepare(_db, "INSERT INTO blobs (digest, refs, code, reflection) VALUES (?, 0, ?, ?) "
+                                    "ON CONFLICT(digest) DO UPDATE SET reflection = excluded.reflection WHERE blobs.reflection IS NULL;",
+                               VSM_ERROR_REPOSITORY_STORE);
+    _store_stmt = prepare(_db, "INSERT INTO shaders (name, stage, compile_digest, digest) VALUES (?, ?, ?, ?) "
+                               "ON CONFLICT(name) DO UPDATE SET stage = excluded.stage, compile_key = NULL, compile_digest = excluded.compile_digest, digest = excluded.digest, generation = generation + 1;",
+                          VSM_ERROR_REPOSITORY_STORE);
+    _store_source_stmt = prepare(_db, "INSERT INTO sources (name, source, preamble, passes) VALUES (?, ?, ?, ?) "
+                                      "ON CONFLICT(name) DO UPDATE SET source = excluded.source, preamble = excluded.preamble, passes = excluded.passes;",
+                                 VSM_ERROR_REPOSITORY_STORE);
+    _store_dependency_stmt = prepare(_db, "INSERT OR REPLACE INTO dependencies (name, header, hash) VALUES (?, ?, ?);", VSM_ERROR_REPOSITORY_STORE);
+    _remove_source_stmt = prepare(_db, "DELETE FROM sources WHERE name = ?;", VSM_ERROR_REPOSITORY_STORE);
+    _remove_dependencies_stmt = prepare(_db, "DELETE FROM dependencies WHERE name = ?;", VSM_ERROR_REPOSITORY_STORE);
+    _load_source_stmt = prepare(_db, load_source_sql, VSM_ERROR_REPOSITORY_QUERY);
+    _load_dependencies_stmt = prepare(_db, load_dependencies_sql, VSM_ERROR_REPOSITORY_QUERY);
+    _cached_stmt = prepare(_db, cached_sql, VSM_ERROR_REPOSITORY_QUERY);
+    // only swaps code the shader still has, so a shader written in the meantime keeps its new code
+    _replace_stmt = prepare(_db, "UPDATE shaders SET digest = ?, generation = generation + 1 WHERE name = ? AND digest = ?;", VSM_ERROR_REPOSITORY_STORE);
+    _generation_stmt = prepare(_db, "SELECT generation FROM shaders WHERE name = ?;", VSM_ERROR_REPOSITORY_QUERY);
+    _store_debug_info_stmt = prepare(_db, "INSERT INTO debug_info (name, code) VALUES (?, ?) ON CONFLICT(name) DO UPDATE SET code = excluded.code;", VSM_ERROR_REPOSITORY_STORE);
+    _remove_debug_info_stmt = prepare(_db, "DELETE FROM debug_info WHERE name = ?;", VSM_ERROR_REPOSITORY_STORE);
+    _load_stmt = prepare(_db, load_sql(debug_info), VSM_ERROR_REPOSITORY_LOAD);
+    _load_reflection_stmt = prepare(_db, load_reflection_sql, VSM_ERROR_REPOSITORY_LOAD);
+    // data that is stored unchanged leaves the row and its pages untouched
+    _store_pipeline_cache_stmt = prepare(_db, "INSERT INTO pipeline_caches (vendor_id, device_id, uuid, data) VALUES (?, ?, ?, ?) "
+                                              "ON CONFLICT(vendor_id, device_id, uuid) DO UPDATE SET data = excluded.data WHERE data IS NOT excluded.data;",
+                                         VSM_ERROR_REPOSITORY_STORE);
+    _load_pipeline_cache_stmt = prepare(_db, "SELECT data FROM pipeline_caches WHERE vendor_id = ? AND device_id = ? AND uuid = ?;", VSM_ERROR_REPOSITORY_LOAD);
+    _query_stmt = prepare(_db, "SELECT stage FROM shaders WHERE name = ?;", VSM_ERROR_REPOSITORY_QUERY);
+    _remove_stmt = prepare(_db, "DELETE FROM shaders WHERE name = ?;", VSM_ERROR_REPOSITORY_REMOVE);
+    _clear_stmt = prepare(_db, "DELETE FROM shaders;", VSM_ERROR_REPOSITORY_CLEAR);
+    // savepoints nest, so a store can be atomic on its own or as part of a larger transaction
+    _begin_stmt = prepare(_db, "SAVEPOINT vsm_transaction;", VSM_ERROR_REPOSITORY_STORE);
+    _commit_stmt = prepare(_db, "RELEASE vsm_transaction;", VSM_ERROR_REPOSITORY_STORE);
+    _rollback_stmt = prepare(_db, "ROLLBACK TO vsm_transaction;", VSM_ERROR_REPOSITORY_STORE);
+}
+
+std::unique_ptr<vsm::sqlite_repository::reader> vsm::sqlite_repository::open_reader() const
+{
+    sqlite3 *db;
+
+    // each reader is only used by the thread that borrowed it, so it needs no mutex of its own
+    if (sqlite3_open_v2(_path.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        throw vsm::exception(VSM_ERROR_REPOSITORY_OPEN);
+    }
+
+    sqlite3_busy_timeout(db, busy_timeout);
+    std::unique_ptr<reader> result(new reader{
+        std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(db, sqlite3_close),
+        statement(nullptr, sqlite3_finalize),
+        statement(nullptr, sqlite3_finalize),
+        statement(nullptr, sqlite3_finalize),
+        statement(nullptr, sqlite3_finalize),
+        statement(nullptr, sqlite3_finalize),
+        statement(nullptr, sqlite3_finalize),
+    });
+    result->cached_stmt = prepare(result->db, cached_sql, VSM_ERROR_REPOSITORY_QUERY);
+    result->load_stmt = prepare(result->db, load_sql(_debug_info), VSM_ERROR_REPOSITORY_LOAD);
+    result->load_reflection_stmt = prepare(result->db, load_reflection_sql, VSM_ERROR_REPOSITORY_LOAD);
+    result->query_stmt = prepare(result->db, "SELECT stage FROM shaders WHERE name = ?;", VSM_ERROR_REPOSITORY_QUERY);
+    result->load_source_stmt = prepare(result->db, load_source_sql, VSM_ERROR_REPOSITORY_QUERY);
+    result->load_dependencies_stmt = prepare(result->db, load_dependencies_sql, VSM_ERROR_REPOSITORY_QUERY);
+    return result;
+}
+
+vsm::sqlite_repository::read_lock::read_lock(sqlite_repository &repository) : _repository(repository)
+{
+    if (_repository._pooled)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_repository._readers_mutex);
+            if (!_repository._readers.empty())
+            {
+                _reader = std::move(_repository._readers.back());
+                _repository._readers.pop_back();
+            }
+        }
+        // the pool grows to the number of threads reading at once
+        if (_reader == nullptr)
+        {
+            _reader = _repository.open_reader();
+        }
+    }
+    else
+    {
+        _lock = std::unique_lock<std::recursive_mutex>(_repository._mutex);
+    }
+}
+
+vsm::sqlite_repository::read_lock::~read_lock()
+{
+    if (_reader != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(_repository._readers_mutex);
+        _repository._readers.push_back(std::move(_reader));
+    }
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::cached_stmt() const
+{
+    return _reader != nullptr ? _reader->cached_stmt.get() : _repository._cached_stmt.get();
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::load_stmt() const
+{
+    return _reader != nullptr ? _reader->load_stmt.get() : _repository._load_stmt.get();
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::load_reflection_stmt() const
+{
+    return _reader != nullptr ? _reader->load_reflection_stmt.get() : _repository._load_reflection_stmt.get();
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::query_stmt() const
+{
+    return _reader != nullptr ? _reader->query_stmt.get() : _repository._query_stmt.get();
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::load_source_stmt() const
+{
+    return _reader != nullptr ? _reader->load_source_stmt.get() : _repository._load_source_stmt.get();
+}
+
+sqlite3_stmt *vsm::sqlite_repository::read_lock::load_dependencies_stmt() const
+{
+    return _reader != nullptr ? _reader->load_dependencies_stmt.get() : _repository._load_dependencies_stmt.get();
+}
+
+void vsm::sqlite_repository::begin()
+{
+    statement_reset stmt(_begin_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+}
+
+void vsm::sqlite_repository::commit()
+{
+    statement_reset stmt(_commit_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+}
+
+void vsm::sqlite_repository::rollback()
+{
+    // a savepoint stays open after rolling back to it, so it is released as well
+    statement_reset rollback_stmt(_rollback_stmt.get(), sqlite3_reset);
+    statement_reset release_stmt(_commit_stmt.get(), sqlite3_reset);
+    sqlite3_step(rollback_stmt.get());
+    sqlite3_step(release_stmt.get());
+}
+
+void vsm::sqlite_repository::store_blob(const digest &hash, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    std::vector<uint8_t> encoded;
+    const void *data = code.data();
+    size_t size = code.size() * sizeof(uint32_t);
+
+    if (_encoding != VSM_CODE_ENCODING_RAW)
+    {
+        vsm::encoding::encode(_encoding, code, encoded);
+        data = encoded.data();
+        size = encoded.size();
+    }
+
+    statement_reset stmt(_store_blob_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_bind_blob(stmt.get(), 1, hash.bytes, sizeof(hash.bytes), SQLITE_STATIC) != SQLITE_OK ||
+        sqlite3_bind_blob(stmt.get(), 2, data, size, SQLITE_STATIC) != SQLITE_OK ||
+        (reflection.empty() ? sqlite3_bind_null(stmt.get(), 3) : sqlite3_bind_blob(stmt.get(), 3, reflection.data(), reflection.size() * sizeof(uint32_t), SQLITE_STATIC)) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+}
+
+void vsm::sqlite_repository::store_debug_info(const std::string &name, const std::vector<uint32_t> &debug)
+{
+    // code without debug instructions leaves no row behind
+    statement_reset stmt(debug.empty() ? _remove_debug_info_stmt.get() : _store_debug_info_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+        (!debug.empty() && sqlite3_bind_blob(stmt.get(), 2, debug.data(), debug.size() * sizeof(uint32_t), SQLITE_STATIC) != SQLITE_OK))
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+    }
+}
+
+void vsm::sqlite_repository::store(const std::string &name, VsmShaderStage stage, const digest &key, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    vsm::debug_info::strip(code, stripped, debug);
+    // SHA-256 of the stripped code, so identical code from different shaders shares one blob
+    const digest hash = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+
+    transaction transaction(*this);
+    forget_preloaded(name);
+    store_blob(hash, stripped, reflection);
+
+    {
+        statement_reset stmt(_store_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_int(stmt.get(), 2, stage) != SQLITE_OK ||
+            sqlite3_bind_blob(stmt.get(), 3, key.bytes, sizeof(key.bytes), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_blob(stmt.get(), 4, hash.bytes, sizeof(hash.bytes), SQLITE_STATIC) != SQLITE_OK)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    store_debug_info(name, debug);
+    transaction.commit();
+}
+
+bool vsm::sqlite_repository::replace(const std::string &name, const std::vector<uint32_t> &previous, const std::vector<uint32_t> &code, const std::vector<uint32_t> &reflection)
+{
+    std::vector<uint32_t> stripped;
+    std::vector<uint32_t> debug;
+    vsm::debug_info::strip(previous, stripped, debug);
+    const digest expected = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+    vsm::debug_info::strip(code, stripped, debug);
+    const digest hash = vsm::sha256::of(stripped.data(), stripped.size() * sizeof(uint32_t));
+
+    // left uncommitted when nothing is swapped, so the new blob is not kept without a reference
+    transaction transaction(*this);
+    store_blob(hash, stripped, reflection);
+
+    {
+        statement_reset stmt(_replace_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_blob(stmt.get(), 1, hash.bytes, sizeof(hash.bytes), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_text(stmt.get(), 2, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_blob(stmt.get(), 3, expected.bytes, sizeof(expected.bytes), SQLITE_STATIC) != SQLITE_OK)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    if (sqlite3_changes(_db.get()) == 0)
+    {
+        return false;
+    }
+
+    forget_preloaded(name);
+    store_debug_info(name, debug);
+    transaction.commit();
+    return true;
+}
+
+uint64_t vsm::sqlite_repository::generation(const std::string &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    statement_reset stmt(_generation_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    return static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 0));
+}
+
+bool vsm::sqlite_repository::cached(const std::string &name, const digest &key)
+{
+    read_lock lock(*this);
+    statement_reset stmt(lock.cached_stmt(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+        sqlite3_bind_blob(stmt.get(), 2, key.bytes, sizeof(key.bytes), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    return sqlite3_step(stmt.get()) == SQLITE_ROW;
+}
+
+void vsm::sqlite_repository::store_source(const compile_request &request, const std::vector<dependency> &dependencies)
+{
+    const std::string &name = request.name;
+    transaction transaction(*this);
+
+    {
+        statement_reset stmt(_remove_dependencies_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    // only shaders with dependencies can go stale, so only they keep their source
+    {
+        statement_reset stmt(dependencies.empty() ? _remove_source_stmt.get() : _store_source_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            (!dependencies.empty() && (sqlite3_bind_text(stmt.get(), 2, request.source.c_str(), request.source.size(), SQLITE_STATIC) != SQLITE_OK ||
+                                       sqlite3_bind_text(stmt.get(), 3, request.preamble.c_str(), request.preamble.size(), SQLITE_STATIC) != SQLITE_OK ||
+                                       sqlite3_bind_text(stmt.get(), 4, request.optimization.passes.c_str(), request.optimization.passes.size(), SQLITE_STATIC) != SQLITE_OK)) ||
+            sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    for (const dependency &dependency : dependencies)
+    {
+        statement_reset stmt(_store_dependency_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_text(stmt.get(), 2, dependency.name.c_str(), dependency.name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_int64(stmt.get(), 3, static_cast<sqlite3_int64>(dependency.hash)) != SQLITE_OK ||
+            sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    transaction.commit();
+}
+
+bool vsm::sqlite_repository::load_source(const std::string &name, compile_request &request, std::vector<dependency> &dependencies)
+{
+    read_lock lock(*this);
+
+    {
+        statement_reset stmt(lock.load_source_stmt(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+        }
+
+        if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+        {
+            return false;
+        }
+
+        request.preamble.assign(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 0)), sqlite3_column_bytes(stmt.get(), 0));
+        request.source.assign(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 1)), sqlite3_column_bytes(stmt.get(), 1));
+        request.optimization.passes.assign(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 2)), sqlite3_column_bytes(stmt.get(), 2));
+    }
+
+    statement_reset stmt(lock.load_dependencies_stmt(), sqlite3_reset);
+    int status;
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    dependencies.clear();
+
+    while ((status = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        dependencies.push_back({std::string(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 0)), sqlite3_column_bytes(stmt.get(), 0)),
+                                static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 1))});
+    }
+
+    if (status != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    return true;
+}
+
+void vsm::sqlite_repository::enumerate_dependencies(function_ref<void(const std::string &, const dependency &)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    statement stmt = prepare(_db, "SELECT name, header, hash FROM dependencies ORDER BY name;", VSM_ERROR_REPOSITORY_QUERY);
+    int status;
+
+    while ((status = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        const std::string name(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 0)), sqlite3_column_bytes(stmt.get(), 0));
+        const dependency dependency = {
+            std::string(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 1)), sqlite3_column_bytes(stmt.get(), 1)),
+            static_cast<uint64_t>(sqlite3_column_int64(stmt.get(), 2)),
+        };
+
+        visitor(name, dependency);
+    }
+
+    if (status != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+}
+
+void vsm::sqlite_repository::visit(sqlite3_stmt *stmt, function_ref<void(const uint32_t *, size_t)> visitor)
+{
+    // reused between calls so unaligned or encoded blobs only allocate while the buffer grows
+    thread_local std::vector<uint32_t> buffer;
+    thread_local std::vector<uint32_t> debug;
+    thread_local std::vector<uint32_t> merged;
+    const void *data = sqlite3_column_blob(stmt, 0);
+    const size_t bytes = sqlite3_column_bytes(stmt, 0);
+    size_t size = bytes / sizeof(uint32_t);
+
+    // the blob stays valid until the statement is reset, so aligned raw code is used in place
+    if (vsm::encoding::is_encoded(data, bytes))
+    {
+        vsm::encoding::decode(data, bytes, buffer);
+        data = buffer.data();
+        size = buffer.size();
+    }
+    else if (reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0)
+    {
+        buffer.resize(size);
+        memcpy(buffer.data(), data, size * sizeof(uint32_t));
+        data = buffer.data();
+    }
+
+    if (_debug_info && sqlite3_column_type(stmt, 1) == SQLITE_BLOB)
+    {
+        debug.resize(sqlite3_column_bytes(stmt, 1) / sizeof(uint32_t));
+        memcpy(debug.data(), sqlite3_column_blob(stmt, 1), debug.size() * sizeof(uint32_t));
+        vsm::debug_info::merge(static_cast<const uint32_t *>(data), size, debug.data(), debug.size(), merged);
+        data = merged.data();
+        size = merged.size();
+    }
+
+    visitor(static_cast<const uint32_t *>(data), size);
+}
+
+void vsm::sqlite_repository::load(const std::string &name, function_ref<void(const uint32_t *, size_t)> visitor)
+{
+    code_location entry;
+
+    // preloaded code is stripped, so debug loads always read the repository
+    if (!_debug_info && find_preloaded(name, entry))
+    {
+        visitor(_arena.data() + entry.offset, entry.size);
+        return;
+    }
+
+    read_lock lock(*this);
+    statement_reset stmt(lock.load_stmt(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    visit(stmt.get(), visitor);
+}
+
+void vsm::sqlite_repository::load(const std::vector<std::string> &names, function_ref<void(size_t, const uint32_t *, size_t)> visitor)
+{
+    std::vector<size_t> order(names.size());
+    code_location entry;
+
+    // looked up in name order, so consecutive lookups walk the same index pages
+    for (size_t index = 0; index < order.size(); index++)
+    {
+        order[index] = index;
+    }
+    std::sort(order.begin(), order.end(), [&names](size_t left, size_t right)
+              { return names[left] < names[right]; });
+
+    // one reader serves the whole batch, rather than one borrowed per shader
+    read_lock lock(*this);
+
+    for (const size_t index : order)
+    {
+        const std::string &name = names[index];
+
+        if (!_debug_info && find_preloaded(name, entry))
+        {
+            visitor(index, _arena.data() + entry.offset, entry.size);
+            continue;
+        }
+
+        statement_reset stmt(lock.load_stmt(), sqlite3_reset);
+
+        if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_step(stmt.get()) != SQLITE_ROW)
+        {
+            continue;
+        }
+
+        try
+        {
+            visit(stmt.get(), [&](const uint32_t *code, size_t size)
+                  { visitor(index, code, size); });
+        }
+        catch (vsm::exception &)
+        {
+        }
+    }
+}
+
+bool vsm::sqlite_repository::load_reflection(const std::string &name, function_ref<void(const void *, size_t)> visitor)
+{
+    read_lock lock(*this);
+    statement_reset stmt(lock.load_reflection_stmt(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    if (sqlite3_column_type(stmt.get(), 0) != SQLITE_BLOB)
+    {
+        return false;
+    }
+
+    // the record is visited where the row holds it, until the statement is reset
+    visitor(sqlite3_column_blob(stmt.get(), 0), sqlite3_column_bytes(stmt.get(), 0));
+    return true;
+}
+
+void vsm::sqlite_repository::store_pipeline_cache(const pipeline_cache_key &key, const void *data, size_t size)
+{
+    transaction transaction(*this);
+
+    {
+        statement_reset stmt(_store_pipeline_cache_stmt.get(), sqlite3_reset);
+
+        if (sqlite3_bind_int64(stmt.get(), 1, key.vendor_id) != SQLITE_OK ||
+            sqlite3_bind_int64(stmt.get(), 2, key.device_id) != SQLITE_OK ||
+            sqlite3_bind_blob(stmt.get(), 3, key.uuid, VK_UUID_SIZE, SQLITE_STATIC) != SQLITE_OK ||
+            sqlite3_bind_blob(stmt.get(), 4, data, size, SQLITE_STATIC) != SQLITE_OK)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            throw vsm::exception(VSM_ERROR_REPOSITORY_STORE);
+        }
+    }
+
+    transaction.commit();
+}
+
+// read once per device at startup, so it goes through the writer rather than the reader pool
+bool vsm::sqlite_repository::load_pipeline_cache(const pipeline_cache_key &key, function_ref<void(const void *, size_t)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    statement_reset stmt(_load_pipeline_cache_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_bind_int64(stmt.get(), 1, key.vendor_id) != SQLITE_OK ||
+        sqlite3_bind_int64(stmt.get(), 2, key.device_id) != SQLITE_OK ||
+        sqlite3_bind_blob(stmt.get(), 3, key.uuid, VK_UUID_SIZE, SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        return false;
+    }
+
+    visitor(sqlite3_column_blob(stmt.get(), 0), sqlite3_column_bytes(stmt.get(), 0));
+    return true;
+}
+
+std::pair<bool, VsmShaderStage> vsm::sqlite_repository::query(const std::string &name)
+{
+    code_location entry;
+
+    if (find_preloaded(name, entry))
+    {
+        return std::make_pair(true, entry.stage);
+    }
+
+    read_lock lock(*this);
+    statement_reset stmt(lock.query_stmt(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+    }
+
+    VsmShaderStage stage = static_cast<VsmShaderStage>(sqlite3_column_int(stmt.get(), 0));
+
+    return std::make_pair(true, stage);
+}
+
+void vsm::sqlite_repository::remove(const std::string &name)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    forget_preloaded(name);
+    statement_reset stmt(_remove_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_bind_text(stmt.get(), 1, name.c_str(), name.size(), SQLITE_STATIC) != SQLITE_OK)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
+    }
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_REMOVE);
+    }
+}
+
+void vsm::sqlite_repository::clear()
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    {
+        std::unique_lock<std::shared_mutex> preloaded_lock(_preloaded_mutex);
+        _preloaded.clear();
+    }
+    statement_reset stmt(_clear_stmt.get(), sqlite3_reset);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_CLEAR);
+    }
+}
+
+void vsm::sqlite_repository::enumerate(function_ref<void(const std::string &, VsmShaderStage, const uint32_t *, size_t)> visitor)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    statement stmt = prepare(_db, "SELECT shaders.name, shaders.stage, blobs.code FROM shaders JOIN blobs ON blobs.digest = shaders.digest;", VSM_ERROR_REPOSITORY_LOAD);
+    std::vector<uint32_t> buffer;
+    int status;
+
+    while ((status = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        const std::string name(reinterpret_cast<const char *>(sqlite3_column_text(stmt.get(), 0)), sqlite3_column_bytes(stmt.get(), 0));
+        const VsmShaderStage stage = static_cast<VsmShaderStage>(sqlite3_column_int(stmt.get(), 1));
+        const void *data = sqlite3_column_blob(stmt.get(), 2);
+        const size_t bytes = sqlite3_column_bytes(stmt.get(), 2);
+
+        if (vsm::encoding::is_encoded(data, bytes))
+        {
+            vsm::encoding::decode(data, bytes, buffer);
+        }
+        else
+        {
+            buffer.resize(bytes / sizeof(uint32_t));
+            memcpy(buffer.data(), data, buffer.size() * sizeof(uint32_t));
+        }
+
+        visitor(name, stage, buffer.data(), buffer.size());
+    }
+
+    if (status != SQLITE_DONE)
+    {
+        throw vsm::exception(VSM_ERROR_REPOSITORY_LOAD);
+    }
+}
+
+void vsm::sqlite_repository::preload()
+{
+    std::vector<uint32_t> arena;
+    std::unordered_map<std::string, code_location> entries;
+
+    // loads only need the code, so reflection records are left out
+    collect(arena, entries, false);
+
+    std::unique_lock<std::shared_mutex> lock(_preloaded_mutex);
+    _arena = std::move(arena);
+    _preloaded = std::move(entries);
+}
+
+bool vsm::sqlite_repository::find_preloaded(const std::string &name, code_location &entry)
+{
+    std::shared_lock<std::shared_mutex> lock(_preloaded_mutex);
+    const auto position = _preloaded.find(name);
+
+    if (position == _preloaded.end())
+    {
+        return false;
+    }
+
+    entry = position->second;
+    return true;
+}
+
+void vsm::sqlite_repository::forget_preloaded(const std::string &name)
+{
+    std::unique_lock<std::shared_mutex> lock(_preloaded_mutex);
+    _preloaded.erase(name);
+}
@@ -10,6 +10,19 @@ std::string vsm::utilities::make_string(const char *raw)
     return result;
 }
 
+uint64_t vsm::utilities::hash(const void *data, size_t size, uint64_t seed)
+{
+    // 64-bit FNV-1a, chained through the seed so several fields can be combined
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint64_t result = seed;
+    for (size_t index = 0; index < size; index++)
+    {
+        result ^= bytes[index];
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
 std::unique_ptr<vsm::compiler> &vsm::utilities::get_compiler(VsmContext context)
 {
     if (context == VK_NULL_HANDLE)
@@ -26,4 +39,404 @@ std::unique_ptr<vsm::repository> &vsm::utilities::get_repository(VsmContext cont
         throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
     }
     return context->repository;
-}
\ No newline at end of file
+}
+
+std::unique_ptr<vsm::worker_pool> &vsm::utilities::get_workers(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    // workers are only started for contexts that compile in parallel
+    std::call_once(context->workers_flag, [context]()
+                   { context->workers = std::make_unique<vsm::worker_pool>(std::thread::hardware_concurrency()); });
+    return context->workers;
+}
+
+std::unique_ptr<vsm::cache> &vsm::utilities::get_cache(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->cache;
+}
+
+std::unique_ptr<vsm::registry> &vsm::utilities::get_registry(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->registry;
+}
+
+std::unique_ptr<vsm::module_cache> &vsm::utilities::get_modules(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->modules;
+}
+
+std::unique_ptr<vsm::pin_list> &vsm::utilities::get_pins(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->pins;
+}
+
+VkShaderStageFlagBits vsm::utilities::stage_flag(VsmShaderStage stage)
+{
+    // indexed by VsmShaderStage
+    static const VkShaderStageFlagBits flags[] = {
+        VK_SHADER_STAGE_VERTEX_BIT,
+        VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+        VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+        VK_SHADER_STAGE_GEOMETRY_BIT,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        VK_SHADER_STAGE_RAYGEN_BIT_KHR,
+        VK_SHADER_STAGE_INTERSECTION_BIT_KHR,
+        VK_SHADER_STAGE_ANY_HIT_BIT_KHR,
+        VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR,
+        VK_SHADER_STAGE_MISS_BIT_KHR,
+        VK_SHADER_STAGE_CALLABLE_BIT_KHR,
+        VK_SHADER_STAGE_TASK_BIT_EXT,
+        VK_SHADER_STAGE_MESH_BIT_EXT,
+    };
+    if (static_cast<uint32_t>(stage) >= VSM_SHADER_MAX_ENUM)
+    {
+        throw vsm::exception(VSM_ERROR_SHADER_STAGE);
+    }
+    return flags[stage];
+}
+
+void vsm::utilities::invalidate(VsmContext context, const std::string &name)
+{
+    get_cache(context)->invalidate(name);
+    get_registry(context)->invalidate(name);
+    get_modules(context)->invalidate(name);
+}
+
+void vsm::utilities::invalidate_all(VsmContext context)
+{
+    get_cache(context)->clear();
+    get_registry(context)->clear();
+    get_modules(context)->clear();
+}
+
+void vsm::utilities::create_module(const VsmShaderModuleCreateInfo &create_info, const VkAllocationCallbacks *allocator, const uint32_t *code, size_t size, VkShaderModule &module)
+{
+    const VkShaderModuleCreateInfo module_info = {
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        create_info.pNext,
+        create_info.flags,
+        size * sizeof(uint32_t),
+        code};
+    if (vkCreateShaderModule(create_info.device, &module_info, allocator, &module) != VK_SUCCESS)
+    {
+        throw vsm::exception(VSM_ERROR_CREATE_MODULE);
+    }
+}
+
+VsmResult vsm::utilities::create_modules(VsmContext context, uint32_t count, const VsmShaderModuleCreateInfo *create_infos, const VkAllocationCallbacks *allocator, VkShaderModule *modules, VsmResult *results)
+{
+    const std::unique_ptr<vsm::cache> &cache = get_cache(context);
+    const std::unique_ptr<vsm::module_cache> &module_cache = get_modules(context);
+    std::vector<std::string> names(count);
+    std::vector<vsm::cache::shared_code> codes(count);
+    std::vector<uint64_t> generations(count, 0);
+    std::vector<uint64_t> module_generations(count, 0);
+    // not std::vector<bool>, whose packed bits would be shared between workers
+    std::vector<uint8_t> shared(count, 0);
+    std::vector<uint8_t> existing(count, 0);
+    std::vector<VsmResult> module_results(count, VSM_SUCCESS);
+    std::vector<std::string> missing_names;
+    std::vector<size_t> missing;
+    VsmResult result = VSM_SUCCESS;
+    for (uint32_t index = 0; index < count; index++)
+    {
+        const VsmShaderModuleCreateInfo &create_info = create_infos[index];
+        names[index] = make_string(create_info.shaderName);
+        modules[index] = VK_NULL_HANDLE;
+        shared[index] = module_cache->enabled() && create_info.pNext == nullptr && create_info.flags == 0;
+        if (shared[index])
+        {
+            modules[index] = module_cache->find(create_info.device, names[index], module_generations[index]);
+            existing[index] = modules[index] != VK_NULL_HANDLE;
+        }
+        if (!existing[index])
+        {
+            codes[index] = cache->find(names[index], generations[index]);
+            if (codes[index] == nullptr)
+            {
+                missing_names.push_back(names[index]);
+                missing.push_back(index);
+            }
+        }
+    }
+    if (!missing.empty())
+    {
+        // the code is copied out, as the modules are created after the repository is released
+        get_repository(context)->load(missing_names, [&](size_t position, const uint32_t *code, size_t size)
+                                      {
+                                          const size_t index = missing[position];
+                                          codes[index] = std::make_shared<const std::vector<uint32_t>>(code, code + size);
+                                          if (cache->enabled())
+                                          {
+                                              cache->insert(names[index], codes[index], generations[index]);
+                                          } });
+    }
+    // vkCreateShaderModule needs no external synchronization, even on the same device
+    get_workers(context)->parallel_for(count, [&](size_t index)
+                                       {
+                                           if (existing[index])
+                                           {
+                                               return;
+                                           }
+                                           if (codes[index] == nullptr)
+                                           {
+                                               module_results[index] = VSM_ERROR_REPOSITORY_LOAD;
+                                               return;
+                                           }
+                                           try
+                                           {
+                                               create_module(create_infos[index], allocator, codes[index]->data(), codes[index]->size(), modules[index]);
+                                           }
+                                           catch (vsm::exception &e)
+                                           {
+                                               modules[index] = VK_NULL_HANDLE;
+                                               module_results[index] = e.result();
+                                           } });
+    for (uint32_t index = 0; index < count; index++)
+    {
+        if (module_results[index] == VSM_SUCCESS && shared[index] && !existing[index])
+        {
+            modules[index] = module_cache->insert(create_infos[index].device, names[index], modules[index], allocator, module_generations[index]);
+        }
+        if (results != nullptr)
+        {
+            results[index] = module_results[index];
+        }
+        if (result == VSM_SUCCESS)
+        {
+            result = module_results[index];
+        }
+    }
+    return result;
+}
+
+const vsm::optimization &vsm::utilities::get_optimization(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->optimization;
+}
+
+std::unique_ptr<vsm::job_list> &vsm::utilities::get_jobs(VsmContext context)
+{
+    if (context == VK_NULL_HANDLE)
+    {
+        throw vsm::exception(VSM_ERROR_INVALID_CONTEXT);
+    }
+    return context->jobs;
+}
+
+vsm::compile_request vsm::utilities::make_request(VsmContext context, const VsmShaderCompileInfo &compile_info)
+{
+    const VsmOptimizationInfo *optimization_info = find_next<VsmOptimizationInfo>(compile_info.pNext, VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO);
+    compile_request request = {
+        make_string(compile_info.shaderName),
+        compile_info.shaderStage,
+        std::string(),
+        make_string(compile_info.shaderSource),
+        optimization_info != nullptr ? optimizer::configure(*optimization_info) : get_optimization(context),
+    };
+    if (compile_info.defineCount > 0 && compile_info.pDefines == nullptr)
+    {
+        throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+    }
+    for (uint32_t index = 0; index < compile_info.defineCount; index++)
+    {
+        if (compile_info.pDefines[index].name == nullptr)
+        {
+            throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+        }
+        request.preamble += "#define ";
+        request.preamble += compile_info.pDefines[index].name;
+        if (compile_info.pDefines[index].value != nullptr)
+        {
+            request.preamble += " ";
+            request.preamble += compile_info.pDefines[index].value;
+        }
+        request.preamble += "\n";
+    }
+    return request;
+}
+
+void vsm::utilities::optimize_later(VsmContext context, const compile_request &request, std::vector<uint32_t> code)
+{
+    // refused once the context is being destroyed, which leaves the stored code unoptimized
+    get_workers(context)->submit([context, request, code = std::move(code)]() mutable
+                                 {
+                                     try
+                                     {
+                                         std::vector<uint32_t> optimized = code;
+                                         std::vector<uint32_t> reflection;
+                                         get_compiler(context)->optimize(request, optimized);
+                                         // passes can remove unused bindings and variables
+                                         vsm::reflection::reflect(optimized, reflection);
+                                         if (get_repository(context)->replace(request.name, code, optimized, reflection))
+                                         {
+                                             invalidate(context, request.name);
+                                         }
+                                     }
+                                     catch (vsm::exception &)
+                                     {
+                                         // the unoptimized code stays usable
+                                     } });
+}
+
+void vsm::utilities::compile(VsmContext context, const compile_request &request)
+{
+    const std::unique_ptr<vsm::compiler> &compiler = get_compiler(context);
+    const std::unique_ptr<vsm::repository> &repository = get_repository(context);
+    const vsm::digest key = compiler->key(request);
+    // an unchanged shader is already stored, so glslang is skipped
+    if (!current(context, request, key))
+    {
+        std::vector<uint32_t> code;
+        std::vector<uint32_t> reflection;
+        std::vector<dependency> dependencies;
+        compiler->compile(request, code, reflection, dependencies);
+        vsm::repository::transaction transaction(*repository);
+        repository->store(request.name, request.stage, key, code, reflection);
+        repository->store_source(request, dependencies);
+        transaction.commit();
+        invalidate(context, request.name);
+        if (request.optimization.tiered && !request.optimization.passes.empty())
+        {
+            optimize_later(context, request, std::move(code));
+        }
+    }
+}
+
+VsmResult vsm::utilities::compile(VsmContext context, const std::vector<compile_request> &requests, VsmResult *results)
+{
+    const std::unique_ptr<vsm::compiler> &compiler = get_compiler(context);
+    const std::unique_ptr<vsm::repository> &repository = get_repository(context);
+    const size_t count = requests.size();
+    std::vector<std::vector<uint32_t>> codes(count);
+    std::vector<std::vector<uint32_t>> reflections(count);
+    std::vector<std::vector<dependency>> dependencies(count);
+    std::vector<vsm::digest> keys(count);
+    // not std::vector<bool>, whose packed bits would be shared between workers
+    std::vector<uint8_t> cached(count, 0);
+    std::vector<VsmResult> compile_results(count, VSM_SUCCESS);
+    VsmResult result = VSM_SUCCESS;
+    get_workers(context)->parallel_for(count, [&](size_t index)
+                                       {
+                                           try
+                                           {
+                                               keys[index] = compiler->key(requests[index]);
+                                               cached[index] = current(context, requests[index], keys[index]);
+                                               if (!cached[index])
+                                               {
+                                                   compiler->compile(requests[index], codes[index], reflections[index], dependencies[index]);
+                                               }
+                                           }
+                                           catch (vsm::exception &e)
+                                           {
+                                               compile_results[index] = e.result();
+                                           } });
+    try
+    {
+        vsm::repository::transaction transaction(*repository);
+        for (size_t index = 0; index < count; index++)
+        {
+            if (compile_results[index] == VSM_SUCCESS && !cached[index])
+            {
+                try
+                {
+                    // a shader whose source fails to store keeps neither, while the others commit
+                    vsm::repository::transaction entry(*repository);
+                    repository->store(requests[index].name, requests[index].stage, keys[index], codes[index], reflections[index]);
+                    repository->store_source(requests[index], dependencies[index]);
+                    entry.commit();
+                }
+                catch (vsm::exception &e)
+                {
+                    compile_results[index] = e.result();
+                }
+            }
+        }
+        transaction.commit();
+        // caches are only invalidated once the writes are visible, so a reader cannot refill them with code that may roll back
+        for (size_t index = 0; index < count; index++)
+        {
+            if (compile_results[index] == VSM_SUCCESS && !cached[index])
+            {
+                invalidate(context, requests[index].name);
+                if (requests[index].optimization.tiered && !requests[index].optimization.passes.empty())
+                {
+                    optimize_later(context, requests[index], std::move(codes[index]));
+                }
+            }
+        }
+    }
+    catch (vsm::exception &e)
+    {
+        // nothing was written, so every shader that compiled failed to store
+        for (size_t index = 0; index < count; index++)
+        {
+            if (compile_results[index] == VSM_SUCCESS && !cached[index])
+            {
+                compile_results[index] = e.result();
+            }
+        }
+    }
+    for (size_t index = 0; index < count; index++)
+    {
+        if (results != nullptr)
+        {
+            results[index] = compile_results[index];
+        }
+        if (result == VSM_SUCCESS)
+        {
+            result = compile_results[index];
+        }
+    }
+    return result;
+}
+
+bool vsm::utilities::current(VsmContext context, const compile_request &request, const digest &key)
+{
+    const std::unique_ptr<vsm::compiler> &compiler = get_compiler(context);
+    const std::unique_ptr<vsm::repository> &repository = get_repository(context);
+    compile_request stored;
+    std::vector<dependency> dependencies;
+    uint64_t hash;
+    if (!repository->cached(request.name, key))
+    {
+        return false;
+    }
+    // only a source that may include headers has dependencies to check
+    if (!compiler->includes(request.source) || !repository->load_source(request.name, stored, dependencies))
+    {
+        return true;
+    }
+    for (const dependency &dependency : dependencies)
+    {
+        if (!compiler->hash_header(dependency.name, hash) || hash != dependency.hash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
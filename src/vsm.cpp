@@ -39,15 +39,53 @@
     }
 
 VSM_API_BEGIN(vsmCreateContext, const VsmContextCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VsmContext *pContext)
-if (pContext == nullptr)
+if (pCreateInfo == nullptr || pContext == nullptr)
 {
     throw vsm::exception(VSM_ERROR_NULL_HANDLE);
 }
+const VsmCodeEncodingCreateInfo *encoding_info = vsm::utilities::find_next<VsmCodeEncodingCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_CODE_ENCODING_CREATE_INFO);
+const VsmCodeEncoding encoding = encoding_info != nullptr ? encoding_info->encoding : VSM_CODE_ENCODING_RAW;
+if (static_cast<uint32_t>(encoding) >= VSM_CODE_ENCODING_MAX_ENUM)
+{
+    throw vsm::exception(VSM_ERROR_CODE_ENCODING);
+}
+const VsmRepositoryCreateInfo *repository_info = vsm::utilities::find_next<VsmRepositoryCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO);
+const VsmRepositoryFormat format = repository_info != nullptr ? repository_info->format : VSM_REPOSITORY_FORMAT_SQLITE;
+const VsmPreloadCreateInfo *preload_info = vsm::utilities::find_next<VsmPreloadCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_PRELOAD_CREATE_INFO);
+const VsmCacheCreateInfo *cache_info = vsm::utilities::find_next<VsmCacheCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_CACHE_CREATE_INFO);
+const VsmOptimizationInfo *optimization_info = vsm::utilities::find_next<VsmOptimizationInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO);
+const VsmIncludeCreateInfo *include_info = vsm::utilities::find_next<VsmIncludeCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_INCLUDE_CREATE_INFO);
+const VsmDebugInfoCreateInfo *debug_info = vsm::utilities::find_next<VsmDebugInfoCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_DEBUG_INFO_CREATE_INFO);
+const VsmModuleCacheCreateInfo *module_cache_info = vsm::utilities::find_next<VsmModuleCacheCreateInfo>(pCreateInfo->pNext, VSM_STRUCTURE_TYPE_MODULE_CACHE_CREATE_INFO);
+std::unique_ptr<vsm::includer> includer;
+if (include_info != nullptr)
+{
+    if (include_info->includePathCount > 0 && include_info->ppIncludePaths == nullptr)
+    {
+        throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+    }
+    std::vector<std::string> include_paths;
+    for (uint32_t index = 0; index < include_info->includePathCount; index++)
+    {
+        include_paths.push_back(vsm::utilities::make_string(include_info->ppIncludePaths[index]));
+    }
+    includer = std::make_unique<vsm::includer>(include_paths, include_info->pfnInclude, include_info->pUserData);
+}
 std::unique_ptr<VsmContext_T> context(new VsmContext_T);
-std::unique_ptr<vsm::compiler> compiler = std::make_unique<vsm::compiler>(pCreateInfo->vulkanVersion, pCreateInfo->spvVersion);
-std::unique_ptr<vsm::repository> repository = std::make_unique<vsm::repository>(vsm::utilities::make_string(pCreateInfo->repositoryPath), pCreateInfo->shared);
+std::unique_ptr<vsm::compiler> compiler = std::make_unique<vsm::compiler>(pCreateInfo->vulkanVersion, pCreateInfo->spvVersion, std::move(includer));
+std::unique_ptr<vsm::repository> repository = vsm::repository::create(format, vsm::utilities::make_string(pCreateInfo->repositoryPath), pCreateInfo->shared, encoding, debug_info != nullptr && debug_info->loadDebugInfo == VK_TRUE);
 context->compiler = std::move(compiler);
+if (preload_info != nullptr && preload_info->preload == VK_TRUE)
+{
+    repository->preload();
+}
 context->repository = std::move(repository);
+context->cache = std::make_unique<vsm::cache>(cache_info != nullptr ? cache_info->cacheSize : 0);
+context->registry = std::make_unique<vsm::registry>();
+context->modules = std::make_unique<vsm::module_cache>(module_cache_info != nullptr && module_cache_info->shareModules == VK_TRUE);
+context->pins = std::make_unique<vsm::pin_list>();
+context->jobs = std::make_unique<vsm::job_list>();
+context->optimization = optimization_info != nullptr ? vsm::optimizer::configure(*optimization_info) : vsm::optimization{};
 *pContext = context.release();
 VSM_API_END
 
@@ -55,9 +93,22 @@ void vsmDestroyContext(VsmContext context, const VkAllocationCallbacks *pAllocat
 {
     if (context != VK_NULL_HANDLE)
     {
-        // TODO: check if reset() is necessary
+        // queued jobs use the rest of the context, including the workers, so they finish first
+        context->jobs->wait_all();
+        // the workers run what the jobs queued while the context can still reach them
+        if (context->workers != nullptr)
+        {
+            context->workers->stop();
+        }
+        context->workers.reset();
+        // destroys shared modules that were never released
+        context->modules.reset();
+        context->pins.reset();
         context->compiler.reset();
         context->repository.reset();
+        context->cache.reset();
+        context->registry.reset();
+        context->jobs.reset();
         delete context;
     }
 }
@@ -67,9 +118,166 @@ if (pCompileInfo == nullptr)
 {
     throw vsm::exception(VSM_ERROR_NULL_HANDLE);
 }
-std::vector<uint32_t> code;
-vsm::utilities::get_compiler(context)->compile(vsm::utilities::make_string(pCompileInfo->shaderName), pCompileInfo->shaderStage, vsm::utilities::make_string(pCompileInfo->shaderSource), code);
-vsm::utilities::get_repository(context)->store(vsm::utilities::make_string(pCompileInfo->shaderName), pCompileInfo->shaderStage, code);
+vsm::utilities::compile(context, vsm::utilities::make_request(context, *pCompileInfo));
+VSM_API_END
+
+VSM_API_BEGIN(vsmCompileShaderAsync, VsmContext context, const VsmShaderCompileInfo *pCompileInfo, PFN_vsmCompileCallback pfnCallback, void *pUserData, VsmJob *pJob)
+if (pCompileInfo == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const std::unique_ptr<vsm::job_list> &jobs = vsm::utilities::get_jobs(context);
+const std::unique_ptr<vsm::worker_pool> &workers = vsm::utilities::get_workers(context);
+const vsm::compile_request request = vsm::utilities::make_request(context, *pCompileInfo);
+const VsmJob job = jobs->create(pJob == nullptr);
+// the callback runs before the job is marked done, so waiting for a job also waits for its callback
+const bool submitted = workers->submit([context, job, request, pfnCallback, pUserData]()
+                {
+                    VsmResult result = VSM_SUCCESS;
+                    try
+                    {
+                        vsm::utilities::compile(context, request);
+                    }
+                    catch (vsm::exception &e)
+                    {
+                        result = e.result();
+                    }
+                    if (pfnCallback != nullptr)
+                    {
+                        pfnCallback(job, result, pUserData);
+                    }
+                    context->jobs->complete(job, result); });
+if (!submitted)
+{
+    // the context is being destroyed, so the job is done without compiling
+    jobs->complete(job, VSM_ERROR_INVALID_CONTEXT);
+}
+if (pJob != nullptr)
+{
+    *pJob = job;
+}
+VSM_API_END
+
+VSM_API_BEGIN(vsmPollJob, VsmContext context, VsmJob job)
+result = vsm::utilities::get_jobs(context)->poll(job);
+VSM_API_END
+
+VSM_API_BEGIN(vsmWaitForJobs, VsmContext context, uint32_t jobCount, const VsmJob *pJobs)
+if (pJobs == nullptr && jobCount > 0)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+result = vsm::utilities::get_jobs(context)->wait(jobCount, pJobs);
+VSM_API_END
+
+VSM_API_BEGIN(vsmDestroyJob, VsmContext context, VsmJob job)
+vsm::utilities::get_jobs(context)->destroy(job);
+VSM_API_END
+
+VSM_API_BEGIN(vsmCompileShaders, VsmContext context, uint32_t compileInfoCount, const VsmShaderCompileInfo *pCompileInfos, VsmResult *pResults)
+if (compileInfoCount > 0 && pCompileInfos == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+std::vector<vsm::compile_request> requests;
+requests.reserve(compileInfoCount);
+for (uint32_t index = 0; index < compileInfoCount; index++)
+{
+    requests.push_back(vsm::utilities::make_request(context, pCompileInfos[index]));
+}
+result = vsm::utilities::compile(context, requests, pResults);
+VSM_API_END
+
+VSM_API_BEGIN(vsmCompilePermutations, VsmContext context, const VsmShaderPermutationInfo *pPermutationInfo, uint32_t *pVariantCount, VsmResult *pResults)
+if (pPermutationInfo == nullptr || pPermutationInfo->pCompileInfo == nullptr || (pPermutationInfo->axisCount > 0 && pPermutationInfo->pAxes == nullptr))
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const vsm::compile_request base = vsm::utilities::make_request(context, *pPermutationInfo->pCompileInfo);
+const uint32_t axis_count = pPermutationInfo->axisCount;
+const VsmShaderPermutationAxis *axes = pPermutationInfo->pAxes;
+size_t variant_count = 1;
+for (uint32_t axis = 0; axis < axis_count; axis++)
+{
+    if (axes[axis].defineName == nullptr || (axes[axis].valueCount > 0 && axes[axis].ppValues == nullptr))
+    {
+        throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+    }
+    variant_count *= axes[axis].valueCount;
+}
+std::vector<vsm::compile_request> requests(variant_count, base);
+// the last axis varies fastest, so a variant's index spells out its value on each axis
+for (size_t variant = 0; variant < variant_count; variant++)
+{
+    size_t stride = variant_count;
+    for (uint32_t axis = 0; axis < axis_count; axis++)
+    {
+        stride /= axes[axis].valueCount;
+        const char *value = axes[axis].ppValues[(variant / stride) % axes[axis].valueCount];
+        if (value != nullptr)
+        {
+            requests[variant].preamble += "#define " + std::string(axes[axis].defineName) + " " + value + "\n";
+            requests[variant].name += "," + std::string(axes[axis].defineName) + "=" + value;
+        }
+    }
+}
+result = vsm::utilities::compile(context, requests, pResults);
+if (pVariantCount != nullptr)
+{
+    *pVariantCount = static_cast<uint32_t>(variant_count);
+}
+VSM_API_END
+
+VSM_API_BEGIN(vsmRebuildStale, VsmContext context, uint32_t *pRebuiltCount)
+const std::unique_ptr<vsm::compiler> &compiler = vsm::utilities::get_compiler(context);
+const std::unique_ptr<vsm::repository> &repository = vsm::utilities::get_repository(context);
+// each header is hashed once, however many shaders include it
+std::unordered_map<std::string, std::pair<bool, uint64_t>> hashes;
+std::vector<std::string> stale;
+repository->enumerate_dependencies([&](const std::string &name, const vsm::dependency &dependency)
+                                   {
+                                       auto position = hashes.find(dependency.name);
+                                       if (position == hashes.end())
+                                       {
+                                           uint64_t hash = 0;
+                                           const bool found = compiler->hash_header(dependency.name, hash);
+                                           position = hashes.emplace(dependency.name, std::make_pair(found, hash)).first;
+                                       }
+                                       if ((!position->second.first || position->second.second != dependency.hash) &&
+                                           (stale.empty() || stale.back() != name))
+                                       {
+                                           stale.push_back(name);
+                                       } });
+std::sort(stale.begin(), stale.end());
+stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+std::vector<vsm::compile_request> requests;
+std::vector<vsm::dependency> dependencies;
+bool missing = false;
+for (const std::string &name : stale)
+{
+    vsm::compile_request request;
+    request.name = name;
+    request.stage = repository->query(name).second;
+    // passes were recorded with the source, while timings go to the context's callback
+    request.optimization = vsm::utilities::get_optimization(context);
+    // a shader without a recorded source cannot be rebuilt, so it is left stale and reported
+    if (!repository->load_source(name, request, dependencies))
+    {
+        missing = true;
+        continue;
+    }
+    requests.push_back(std::move(request));
+}
+std::vector<VsmResult> results(requests.size());
+result = vsm::utilities::compile(context, requests, results.data());
+if (result == VSM_SUCCESS && missing)
+{
+    result = VSM_ERROR_REPOSITORY_LOAD;
+}
+if (pRebuiltCount != nullptr)
+{
+    *pRebuiltCount = static_cast<uint32_t>(std::count(results.begin(), results.end(), VSM_SUCCESS));
+}
 VSM_API_END
 
 VSM_API_BEGIN(vsmQueryShader, VsmContext context, const char *shaderName, VkBool32 *pFound, VsmShaderStage *pShaderStage)
@@ -85,25 +293,288 @@ if (pShaderStage != nullptr)
 }
 VSM_API_END
 
+VSM_API_BEGIN(vsmGetShaderGeneration, VsmContext context, const char *shaderName, uint64_t *pGeneration)
+if (pGeneration == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+*pGeneration = vsm::utilities::get_repository(context)->generation(vsm::utilities::make_string(shaderName));
+VSM_API_END
+
+VSM_API_BEGIN(vsmGetShaderReflection, VsmContext context, const char *shaderName, VsmShaderReflection *pReflection)
+if (pReflection == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+// the record is copied straight from where the repository holds it into the caller's arrays
+const bool found = vsm::utilities::get_repository(context)->load_reflection(vsm::utilities::make_string(shaderName), [&](const void *data, size_t size)
+                                                                           { result = vsm::reflection::read(data, size, *pReflection); });
+if (!found)
+{
+    throw vsm::exception(VSM_ERROR_REPOSITORY_QUERY);
+}
+VSM_API_END
+
 VSM_API_BEGIN(vsmRemoveShader, VsmContext context, const char *shaderName)
-vsm::utilities::get_repository(context)->remove(vsm::utilities::make_string(shaderName));
+const std::string name = vsm::utilities::make_string(shaderName);
+vsm::utilities::get_repository(context)->remove(name);
+vsm::utilities::invalidate(context, name);
 VSM_API_END
 
 VSM_API_BEGIN(vsmClearShaders, VsmContext context)
 vsm::utilities::get_repository(context)->clear();
+vsm::utilities::invalidate_all(context);
 VSM_API_END
 
 VSM_API_BEGIN(vsmCreateShaderModule, VsmContext context, const VsmShaderModuleCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModule)
-std::vector<uint32_t> code;
-vsm::utilities::get_repository(context)->load(vsm::utilities::make_string(pCreateInfo->shaderName), code);
-const VkShaderModuleCreateInfo createInfo = {
+if (pCreateInfo == nullptr || pShaderModule == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const std::unique_ptr<vsm::cache> &cache = vsm::utilities::get_cache(context);
+const std::string name = vsm::utilities::make_string(pCreateInfo->shaderName);
+const std::unique_ptr<vsm::module_cache> &modules = vsm::utilities::get_modules(context);
+// modules created with extension structures or flags are the caller's own
+const bool shared = modules->enabled() && pCreateInfo->pNext == nullptr && pCreateInfo->flags == 0;
+uint64_t module_generation = 0;
+const VkShaderModule existing = shared ? modules->find(pCreateInfo->device, name, module_generation) : VK_NULL_HANDLE;
+if (existing != VK_NULL_HANDLE)
+{
+    *pShaderModule = existing;
+}
+else
+{
+    uint64_t generation;
+    const vsm::cache::shared_code cached = cache->find(name, generation);
+    if (cached != nullptr)
+    {
+        vsm::utilities::create_module(*pCreateInfo, pAllocator, cached->data(), cached->size(), *pShaderModule);
+    }
+    else
+    {
+        vsm::utilities::get_repository(context)->load(name, [&](const uint32_t *code, size_t size)
+                                                      {
+                                                          vsm::utilities::create_module(*pCreateInfo, pAllocator, code, size, *pShaderModule);
+                                                          if (cache->enabled())
+                                                          {
+                                                              cache->insert(name, std::make_shared<const std::vector<uint32_t>>(code, code + size), generation);
+                                                          } });
+    }
+    if (shared)
+    {
+        *pShaderModule = modules->insert(pCreateInfo->device, name, *pShaderModule, pAllocator, module_generation);
+    }
+}
+VSM_API_END
+
+VSM_API_BEGIN(vsmCreateShaderModules, VsmContext context, uint32_t createInfoCount, const VsmShaderModuleCreateInfo *pCreateInfos, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModules, VsmResult *pResults)
+if (createInfoCount > 0 && (pCreateInfos == nullptr || pShaderModules == nullptr))
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+result = vsm::utilities::create_modules(context, createInfoCount, pCreateInfos, pAllocator, pShaderModules, pResults);
+VSM_API_END
+
+VSM_API_BEGIN(vsmReleaseShaderModule, VsmContext context, VkDevice device, VkShaderModule shaderModule, const VkAllocationCallbacks *pAllocator)
+if (!vsm::utilities::get_modules(context)->release(shaderModule))
+{
+    vkDestroyShaderModule(device, shaderModule, pAllocator);
+}
+VSM_API_END
+
+VSM_API_BEGIN(vsmGetPipelineShaderStageCreateInfo, VsmContext context, const char *shaderName, VkPipelineShaderStageCreateInfo *pStageCreateInfo, VkShaderModuleCreateInfo *pModuleCreateInfo)
+if (pStageCreateInfo == nullptr || pModuleCreateInfo == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const std::unique_ptr<vsm::registry> &registry = vsm::utilities::get_registry(context);
+const std::unique_ptr<vsm::repository> &repository = vsm::utilities::get_repository(context);
+const VsmShader shader = registry->get(vsm::utilities::make_string(shaderName));
+// the handle keeps the code it last read, so the code is pinned without copying it
+VsmShaderStage shader_stage;
+const vsm::cache::shared_code code = registry->load(shader, *repository, shader_stage);
+const VkShaderStageFlagBits stage = vsm::utilities::stage_flag(shader_stage);
+*pModuleCreateInfo = {
     VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-    pCreateInfo->pNext,
-    pCreateInfo->flags,
-    code.size() * sizeof(uint32_t),
-    code.data()};
-if (vkCreateShaderModule(pCreateInfo->device, &createInfo, pAllocator, pShaderModule) != VK_SUCCESS)
+    nullptr,
+    0,
+    code->size() * sizeof(uint32_t),
+    vsm::utilities::get_pins(context)->pin(code)};
+*pStageCreateInfo = {
+    VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+    pModuleCreateInfo,
+    0,
+    stage,
+    VK_NULL_HANDLE,
+    "main",
+    nullptr};
+VSM_API_END
+
+VSM_API_BEGIN(vsmReleasePipelineShaderStageCreateInfo, VsmContext context, const VkPipelineShaderStageCreateInfo *pStageCreateInfo)
+if (pStageCreateInfo == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const void *next = pStageCreateInfo->pNext;
+while (next != nullptr && static_cast<const VkBaseInStructure *>(next)->sType != VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO)
+{
+    next = static_cast<const VkBaseInStructure *>(next)->pNext;
+}
+if (next == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+vsm::utilities::get_pins(context)->release(static_cast<const VkShaderModuleCreateInfo *>(next)->pCode);
+VSM_API_END
+
+VSM_API_BEGIN(vsmStorePipelineCache, VsmContext context, size_t dataSize, const void *pData)
+if (pData == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+vsm::pipeline_cache_key key;
+if (!vsm::pipeline_cache::key(pData, dataSize, key))
+{
+    throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+}
+vsm::utilities::get_repository(context)->store_pipeline_cache(key, pData, dataSize);
+VSM_API_END
+
+VSM_API_BEGIN(vsmMergePipelineCache, VsmContext context, VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks *pAllocator)
+if (device == VK_NULL_HANDLE || pipelineCache == VK_NULL_HANDLE)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const std::unique_ptr<vsm::repository> &repository = vsm::utilities::get_repository(context);
+std::vector<uint8_t> data;
+std::vector<uint8_t> merged;
+vsm::pipeline_cache_key key;
+vsm::pipeline_cache::data(device, pipelineCache, data);
+if (!vsm::pipeline_cache::key(data.data(), data.size(), key))
+{
+    throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+}
+// the stored data is read and written back under one transaction, so concurrent merges are not lost
+vsm::repository::transaction transaction(*repository);
+repository->load_pipeline_cache(key, [&](const void *stored, size_t stored_size)
+                                {
+                                    // data whose header does not name the device is never handed to its driver
+                                    vsm::pipeline_cache_key stored_key;
+                                    if (vsm::pipeline_cache::key(stored, stored_size, stored_key) && vsm::pipeline_cache::equal(stored_key, key))
+                                    {
+                                        vsm::pipeline_cache::merge(device, pAllocator, stored, stored_size, pipelineCache, merged);
+                                    } });
+if (merged.empty())
+{
+    merged = std::move(data);
+}
+else if (!vsm::pipeline_cache::key(merged.data(), merged.size(), key))
+{
+    throw vsm::exception(VSM_ERROR_PIPELINE_CACHE);
+}
+repository->store_pipeline_cache(key, merged.data(), merged.size());
+transaction.commit();
+VSM_API_END
+
+VSM_API_BEGIN(vsmLoadPipelineCache, VsmContext context, const VkPhysicalDeviceProperties *pProperties, size_t *pDataSize, void *pData)
+if (pProperties == nullptr || pDataSize == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const vsm::pipeline_cache_key key = vsm::pipeline_cache::key(*pProperties);
+size_t size = 0;
+vsm::utilities::get_repository(context)->load_pipeline_cache(key, [&](const void *data, size_t stored_size)
+                                                             {
+                                                                 // data whose header does not name the device is never handed to its driver
+                                                                 vsm::pipeline_cache_key stored;
+                                                                 if (!vsm::pipeline_cache::key(data, stored_size, stored) || !vsm::pipeline_cache::equal(stored, key))
+                                                                 {
+                                                                     return;
+                                                                 }
+                                                                 size = stored_size;
+                                                                 if (pData != nullptr)
+                                                                 {
+                                                                     if (*pDataSize < size)
+                                                                     {
+                                                                         result = VSM_INCOMPLETE;
+                                                                     }
+                                                                     else
+                                                                     {
+                                                                         memcpy(pData, data, size);
+                                                                     }
+                                                                 }
+                                                             });
+*pDataSize = size;
+VSM_API_END
+
+VSM_API_BEGIN(vsmGetCacheStatistics, VsmContext context, VsmCacheStatistics *pStatistics)
+if (pStatistics == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+*pStatistics = vsm::utilities::get_cache(context)->statistics();
+VSM_API_END
+
+VSM_API_BEGIN(vsmExportPack, VsmContext context, const char *packPath)
+if (packPath == nullptr)
 {
-    throw vsm::exception(VSM_ERROR_CREATE_MODULE);
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+vsm::utilities::get_repository(context)->export_pack(packPath);
+VSM_API_END
+
+VSM_API_BEGIN(vsmGetShaderHandle, VsmContext context, const char *shaderName, VsmShader *pShader)
+if (pShader == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+*pShader = vsm::utilities::get_registry(context)->get(vsm::utilities::make_string(shaderName));
+VSM_API_END
+
+VSM_API_BEGIN(vsmQueryShaderHandle, VsmContext context, VsmShader shader, VkBool32 *pFound, VsmShaderStage *pShaderStage)
+if (shader == VK_NULL_HANDLE)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const VsmShaderStage stage = vsm::utilities::get_registry(context)->query(shader, *vsm::utilities::get_repository(context));
+if (pFound != nullptr)
+{
+    *pFound = VK_TRUE;
+}
+if (pShaderStage != nullptr)
+{
+    *pShaderStage = stage;
+}
+VSM_API_END
+
+VSM_API_BEGIN(vsmCreateShaderModuleFromHandle, VsmContext context, const VsmShaderModuleHandleCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModule)
+if (pCreateInfo == nullptr || pCreateInfo->shader == VK_NULL_HANDLE || pShaderModule == nullptr)
+{
+    throw vsm::exception(VSM_ERROR_NULL_HANDLE);
+}
+const std::string &name = pCreateInfo->shader->name;
+const std::unique_ptr<vsm::module_cache> &modules = vsm::utilities::get_modules(context);
+// shared with vsmCreateShaderModule, so a module is created once per device whichever way the shader is named
+const bool shared = modules->enabled() && pCreateInfo->pNext == nullptr && pCreateInfo->flags == 0;
+uint64_t module_generation = 0;
+const VkShaderModule existing = shared ? modules->find(pCreateInfo->device, name, module_generation) : VK_NULL_HANDLE;
+if (existing != VK_NULL_HANDLE)
+{
+    *pShaderModule = existing;
+}
+else
+{
+    const vsm::cache::shared_code code = vsm::utilities::get_registry(context)->load(pCreateInfo->shader, *vsm::utilities::get_repository(context));
+    const VsmShaderModuleCreateInfo create_info = {
+        pCreateInfo->device,
+        name.c_str(),
+        pCreateInfo->pNext,
+        pCreateInfo->flags,
+    };
+    vsm::utilities::create_module(create_info, pAllocator, code->data(), code->size(), *pShaderModule);
+    if (shared)
+    {
+        *pShaderModule = modules->insert(pCreateInfo->device, name, *pShaderModule, pAllocator, module_generation);
+    }
 }
 VSM_API_END
\ No newline at end of file
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 Maxtek Consulting
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "internal.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+vsm::worker_pool::worker_pool(size_t size) : _stopping(false)
+{
+    for (size_t index = 0; index < std::max<size_t>(size, 1); index++)
+    {
+        _threads.emplace_back(&vsm::worker_pool::run, this);
+    }
+}
+
+vsm::worker_pool::~worker_pool()
+{
+    stop();
+}
+
+void vsm::worker_pool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+    for (std::thread &thread : _threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+}
+
+size_t vsm::worker_pool::size() const
+{
+    return _threads.size();
+}
+
+void vsm::worker_pool::run()
+{
+    std::function<void()> task;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]()
+                            { return _stopping || !_tasks.empty(); });
+            // pending tasks are drained before the workers exit
+            if (_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+bool vsm::worker_pool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping)
+        {
+            return false;
+        }
+        _tasks.push_back(std::move(task));
+    }
+    _condition.notify_one();
+    return true;
+}
+
+void vsm::worker_pool::parallel_for(size_t count, const std::function<void(size_t)> &body)
+{
+    // helpers that start after every index has been claimed return without touching the body,
+    // so the caller only has to wait for the helpers that are still running
+    struct state
+    {
+        const std::function<void(size_t)> *body;
+        size_t count;
+        std::atomic<size_t> next;
+        std::atomic<size_t> active;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::exception_ptr error;
+    };
+    std::shared_ptr<state> shared = std::make_shared<state>();
+    shared->body = &body;
+    shared->count = count;
+    shared->next = 0;
+    shared->active = 0;
+
+    const auto work = [](state &shared)
+    {
+        size_t index;
+        while ((index = shared.next++) < shared.count)
+        {
+            try
+            {
+                (*shared.body)(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                if (!shared.error)
+                {
+                    shared.error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    const size_t helpers = count > 1 ? std::min(count - 1, size()) : 0;
+    // helpers the pool refuses while it stops leave their indices to the caller
+    for (size_t index = 0; index < helpers; index++)
+    {
+        submit([shared, work]()
+               {
+                   shared->active++;
+                   work(*shared);
+                   std::lock_guard<std::mutex> lock(shared->mutex);
+                   if (--shared->active == 0)
+                   {
+                       shared->condition.notify_all();
+                   } });
+    }
+
+    // the caller works too, which keeps nested calls from a worker thread deadlock free
+    work(*shared);
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->condition.wait(lock, [&shared]()
+                           { return shared->active == 0; });
+    if (shared->error)
+    {
+        std::rethrow_exception(shared->error);
+    }
+}
@@ -22,9 +22,20 @@
 
 #include <vk_shader_manager.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <new>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 
 #ifndef __FUNCTION_NAME__
@@ -44,6 +55,12 @@ const std::string shader_source =
     "void main(){\n"
     "}\n";
 
+const std::string invalid_source =
+    "#version 430\n"
+    "void main(){\n"
+    "    syntax_error();\n"
+    "}\n";
+
 static void test_assert(
     bool condition,
     const std::string &file,
@@ -51,16 +68,152 @@ static void test_assert(
     int line,
     const std::string &description);
 
+// heap allocations made through operator new, counted for hot path tests
+static std::atomic<size_t> allocation_count(0);
+
+void *operator new(size_t size)
+{
+    allocation_count++;
+    void *result = std::malloc(size > 0 ? size : 1);
+    if (result == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// counting stubs in place of the Vulkan driver
+namespace stub
+{
+    static size_t create_module_count = 0;
+    static uint32_t last_magic = 0;
+    static bool last_aligned = false;
+    static size_t last_code_size = 0;
+    static uint32_t last_code_checksum = 0;
+    static size_t destroy_module_count = 0;
+    static VkShaderModule last_destroyed = VK_NULL_HANDLE;
+    // the data of each live pipeline cache, where merging appends the source's entries
+    static std::unordered_map<uint64_t, std::vector<uint8_t>> pipeline_caches;
+    static uint64_t create_pipeline_cache_count = 0;
+    // vsmCreateShaderModules calls the driver from several threads at once
+    static std::mutex mutex;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateShaderModule(VkDevice device, const VkShaderModuleCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModule)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    stub::create_module_count++;
+    stub::last_magic = pCreateInfo->pCode[0];
+    stub::last_aligned = reinterpret_cast<uintptr_t>(pCreateInfo->pCode) % alignof(uint32_t) == 0;
+    stub::last_code_size = pCreateInfo->codeSize;
+    stub::last_code_checksum = 0;
+    for (size_t index = 0; index < pCreateInfo->codeSize / sizeof(uint32_t); index++)
+    {
+        stub::last_code_checksum = stub::last_code_checksum * 31 + pCreateInfo->pCode[index];
+    }
+    *pShaderModule = reinterpret_cast<VkShaderModule>(stub::create_module_count);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyShaderModule(VkDevice device, VkShaderModule shaderModule, const VkAllocationCallbacks *pAllocator)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    stub::destroy_module_count++;
+    stub::last_destroyed = shaderModule;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreatePipelineCache(VkDevice device, const VkPipelineCacheCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkPipelineCache *pPipelineCache)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    const uint8_t *data = static_cast<const uint8_t *>(pCreateInfo->pInitialData);
+    stub::create_pipeline_cache_count++;
+    stub::pipeline_caches[stub::create_pipeline_cache_count].assign(data, data + pCreateInfo->initialDataSize);
+    *pPipelineCache = reinterpret_cast<VkPipelineCache>(stub::create_pipeline_cache_count);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineCache(VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks *pAllocator)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    stub::pipeline_caches.erase(reinterpret_cast<uint64_t>(pipelineCache));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache, size_t *pDataSize, void *pData)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    const std::vector<uint8_t> &data = stub::pipeline_caches.at(reinterpret_cast<uint64_t>(pipelineCache));
+    if (pData == nullptr)
+    {
+        *pDataSize = data.size();
+        return VK_SUCCESS;
+    }
+    *pDataSize = std::min(*pDataSize, data.size());
+    memcpy(pData, data.data(), *pDataSize);
+    return *pDataSize < data.size() ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMergePipelineCaches(VkDevice device, VkPipelineCache dstCache, uint32_t srcCacheCount, const VkPipelineCache *pSrcCaches)
+{
+    std::lock_guard<std::mutex> lock(stub::mutex);
+    std::vector<uint8_t> &destination = stub::pipeline_caches.at(reinterpret_cast<uint64_t>(dstCache));
+    for (uint32_t index = 0; index < srcCacheCount; index++)
+    {
+        const std::vector<uint8_t> &source = stub::pipeline_caches.at(reinterpret_cast<uint64_t>(pSrcCaches[index]));
+        destination.insert(destination.end(), source.begin() + sizeof(VkPipelineCacheHeaderVersionOne), source.end());
+    }
+    return VK_SUCCESS;
+}
+
 // API tests
 namespace api
 {
     static void create_context();
     static void destroy_context();
     static void compile_shader();
-    static void query_shader(){}
-    static void remove_shader(){}
-    static void clear_shaders(){}
-    static void create_shader_module(){}
+    static void compile_shaders();
+    static void query_shader();
+    static void remove_shader();
+    static void clear_shaders();
+    static void create_shader_module();
+    static void code_encoding();
+    static void cache_statistics();
+    static void shared_context();
+    static void preload();
+    static void shader_handle();
+    static void export_pack();
+    static void sqlite_backend();
+    static void memory_backend();
+    static void pack_backend();
+    static void compile_shader_async();
+    static void concurrent_compile();
+    static void include_shader();
+    static void rebuild_stale();
+    static void compile_permutations();
+    static void optimize_shader();
+    static void tiered_optimization();
+    static void debug_info();
+    static void shader_reflection();
+    static void module_cache();
+    static void pipeline_cache();
+    static void create_shader_modules();
+    static void pipeline_shader_stage();
+}
+
+// conformance checks shared by every repository format
+namespace conformance
+{
+    static void contents(VsmContext context, const VsmShaderCompileInfo *compile_infos, uint32_t count);
+    static void writes(VsmContext context);
 }
 
 #define TEST_CASE(NAME) {#NAME, NAME}
@@ -71,10 +224,33 @@ int main(int argc, const char **argv)
         TEST_CASE(api::create_context),
         TEST_CASE(api::destroy_context),
         TEST_CASE(api::compile_shader),
+        TEST_CASE(api::compile_shaders),
         TEST_CASE(api::query_shader),
         TEST_CASE(api::remove_shader),
         TEST_CASE(api::clear_shaders),
         TEST_CASE(api::create_shader_module),
+        TEST_CASE(api::code_encoding),
+        TEST_CASE(api::cache_statistics),
+        TEST_CASE(api::shared_context),
+        TEST_CASE(api::preload),
+        TEST_CASE(api::shader_handle),
+        TEST_CASE(api::export_pack),
+        TEST_CASE(api::sqlite_backend),
+        TEST_CASE(api::memory_backend),
+        TEST_CASE(api::pack_backend),
+        TEST_CASE(api::compile_shader_async),
+        TEST_CASE(api::concurrent_compile),
+        TEST_CASE(api::include_shader),
+        TEST_CASE(api::rebuild_stale),
+        TEST_CASE(api::compile_permutations),
+        TEST_CASE(api::optimize_shader),
+        TEST_CASE(api::tiered_optimization),
+        TEST_CASE(api::debug_info),
+        TEST_CASE(api::shader_reflection),
+        TEST_CASE(api::module_cache),
+        TEST_CASE(api::pipeline_cache),
+        TEST_CASE(api::create_shader_modules),
+        TEST_CASE(api::pipeline_shader_stage),
     };
     int result = TEST_PASS;
     if (argc > 1)
@@ -169,5 +345,2446 @@ void api::compile_shader()
     result = vsmCompileShader(context, &compile_info);
     TEST_ASSERT(result == VSM_SUCCESS);
 
+    // unchanged source is served from the repository
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // changed source is compiled again
+    compile_info.shaderSource = invalid_source.c_str();
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PARSE);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::query_shader()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkBool32 found;
+    VsmShaderStage stage;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+
+    result = vsmQueryShader(nullptr, "test", &found, &stage);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    // repeated queries reuse the same prepared statement
+    for (int i = 0; i < 2; i++)
+    {
+        found = VK_FALSE;
+        stage = VSM_SHADER_MAX_ENUM;
+        result = vsmQueryShader(context, "test", &found, &stage);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(found == VK_TRUE);
+        TEST_ASSERT(stage == VSM_SHADER_COMPUTE);
+    }
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::compile_shaders()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    const VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"invalid", shader_source.c_str(), VSM_SHADER_MAX_ENUM},
+        {"second", shader_source.c_str(), VSM_SHADER_COMPUTE},
+    };
+    VsmResult results[3];
+    VsmContext context;
+    VsmResult result;
+    VkBool32 found;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+
+    result = vsmCompileShaders(nullptr, 3, compile_infos, results);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    result = vsmCompileShaders(context, 3, nullptr, results);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // one failure does not abort the rest of the batch
+    result = vsmCompileShaders(context, 3, compile_infos, results);
+    TEST_ASSERT(result == VSM_ERROR_SHADER_STAGE);
+    TEST_ASSERT(results[0] == VSM_SUCCESS);
+    TEST_ASSERT(results[1] == VSM_ERROR_SHADER_STAGE);
+    TEST_ASSERT(results[2] == VSM_SUCCESS);
+
+    result = vsmQueryShader(context, "first", &found, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS && found == VK_TRUE);
+    result = vsmQueryShader(context, "second", &found, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS && found == VK_TRUE);
+
+    result = vsmCompileShaders(context, 0, nullptr, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::create_shader_module()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "test",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    size_t allocations;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+
+    result = vsmCreateShaderModule(nullptr, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    result = vsmCreateShaderModule(context, nullptr, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::create_module_count == 1);
+    TEST_ASSERT(stub::last_code_size > 0 && stub::last_code_size % sizeof(uint32_t) == 0);
+    TEST_ASSERT(stub::last_aligned);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+
+    // steady state module creation does not allocate
+    allocations = allocation_count;
+    for (int i = 0; i < 100 && result == VSM_SUCCESS; i++)
+    {
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    }
+    allocations = allocation_count - allocations;
+    TEST_ASSERT(allocations == 0);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::create_module_count == 101);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::remove_shader()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    // both names compile to identical code, which is stored once
+    const VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", shader_source.c_str(), VSM_SHADER_COMPUTE},
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "first",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShaders(context, 2, compile_infos, nullptr));
+
+    result = vsmRemoveShader(nullptr, "first");
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    result = vsmRemoveShader(context, "first");
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+
+    // the shared code is still referenced by the remaining shader
+    module_info.shaderName = "second";
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+
+    result = vsmRemoveShader(context, "second");
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+
     vsmDestroyContext(context, nullptr);
-}
\ No newline at end of file
+}
+
+void api::clear_shaders()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    const VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", shader_source.c_str(), VSM_SHADER_COMPUTE},
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "second",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShaders(context, 2, compile_infos, nullptr));
+
+    result = vsmClearShaders(nullptr);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+
+    // storing again after a clear recreates the shared code
+    result = vsmCompileShaders(context, 2, compile_infos, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::code_encoding()
+{
+    VsmCodeEncodingCreateInfo encoding_info = {
+        VSM_STRUCTURE_TYPE_CODE_ENCODING_CREATE_INFO,
+        nullptr,
+        VSM_CODE_ENCODING_MAX_ENUM,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &encoding_info,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "test",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    size_t raw_size;
+    uint32_t raw_checksum;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_CODE_ENCODING);
+
+    // every encoding loads back the code the raw encoding stores
+    for (VsmCodeEncoding encoding : {VSM_CODE_ENCODING_RAW, VSM_CODE_ENCODING_VARINT, VSM_CODE_ENCODING_COMPACT})
+    {
+        encoding_info.encoding = encoding;
+        result = vsmCreateContext(&create_info, nullptr, &context);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmCompileShader(context, &compile_info);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stub::last_magic == 0x07230203);
+        if (encoding == VSM_CODE_ENCODING_RAW)
+        {
+            raw_size = stub::last_code_size;
+            raw_checksum = stub::last_code_checksum;
+        }
+        TEST_ASSERT(stub::last_code_size == raw_size);
+        TEST_ASSERT(stub::last_code_checksum == raw_checksum);
+        vsmDestroyContext(context, nullptr);
+    }
+}
+
+void api::cache_statistics()
+{
+    VsmCacheCreateInfo cache_info = {
+        VSM_STRUCTURE_TYPE_CACHE_CREATE_INFO,
+        nullptr,
+        1 << 20,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &cache_info,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "test",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    VsmCacheStatistics statistics;
+    uint32_t checksum;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetCacheStatistics(context, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // the first load misses, later loads hit and pass the same code
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    checksum = stub::last_code_checksum;
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    result = vsmGetCacheStatistics(context, &statistics);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(statistics.hits == 1);
+    TEST_ASSERT(statistics.misses == 1);
+    TEST_ASSERT(statistics.entryCount == 1);
+    TEST_ASSERT(statistics.size == stub::last_code_size);
+
+    // an unchanged recompile leaves the entry, a removal drops it
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetCacheStatistics(context, &statistics);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(statistics.entryCount == 1);
+    result = vsmRemoveShader(context, "test");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetCacheStatistics(context, &statistics);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(statistics.entryCount == 0);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+
+    // clearing the repository empties the cache
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetCacheStatistics(context, &statistics);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(statistics.entryCount == 0);
+    TEST_ASSERT(statistics.size == 0);
+    vsmDestroyContext(context, nullptr);
+
+    // a budget smaller than the code never holds it
+    cache_info.cacheSize = sizeof(uint32_t);
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    result = vsmGetCacheStatistics(context, &statistics);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(statistics.hits == 0);
+    TEST_ASSERT(statistics.misses == 2);
+    TEST_ASSERT(statistics.entryCount == 0);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::shared_context()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_shared_context.db").string();
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        true,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    const std::string changed_source = shader_source + "\n";
+    VsmShaderCompileInfo writer_info = {
+        "writer",
+        shader_source.c_str(),
+        VSM_SHADER_FRAGMENT,
+    };
+    VsmContext context;
+    VsmResult result;
+    std::vector<std::thread> readers;
+    std::atomic<size_t> failures(0);
+
+    std::filesystem::remove(path);
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(std::filesystem::exists(path + "-wal"));
+
+    // readers query from their own connections while the writer keeps storing
+    for (int thread = 0; thread < 4; thread++)
+    {
+        readers.emplace_back([&]()
+                             {
+                                 for (int i = 0; i < 1000; i++)
+                                 {
+                                     VkBool32 found = VK_FALSE;
+                                     VsmShaderStage stage = VSM_SHADER_MAX_ENUM;
+                                     if (vsmQueryShader(context, "test", &found, &stage) != VSM_SUCCESS || found != VK_TRUE || stage != VSM_SHADER_COMPUTE)
+                                     {
+                                         failures++;
+                                     }
+                                 } });
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        writer_info.shaderSource = i % 2 == 0 ? shader_source.c_str() : changed_source.c_str();
+        if (vsmCompileShader(context, &writer_info) != VSM_SUCCESS)
+        {
+            failures++;
+        }
+    }
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    TEST_ASSERT(failures == 0);
+
+    // writes are visible to readers once committed
+    result = vsmRemoveShader(context, "test");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "test", nullptr, nullptr);
+    TEST_ASSERT(result != VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+
+    // the repository reopens with its contents
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "writer", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+    std::filesystem::remove(path);
+}
+
+void api::preload()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_preload.db").string();
+    VsmPreloadCreateInfo preload_info = {
+        VSM_STRUCTURE_TYPE_PRELOAD_CREATE_INFO,
+        nullptr,
+        VK_TRUE,
+    };
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", shader_source.c_str(), VSM_SHADER_VERTEX},
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "first",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    VsmShaderStage stage;
+    uint32_t checksum;
+
+    std::filesystem::remove(path);
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShaders(context, 2, compile_infos, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    checksum = stub::last_code_checksum;
+    vsmDestroyContext(context, nullptr);
+
+    // preloaded shaders load and query as they do from the repository
+    create_info.pNext = &preload_info;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+    TEST_ASSERT(stub::last_aligned);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    result = vsmQueryShader(context, "second", nullptr, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage == VSM_SHADER_VERTEX);
+
+    // later writes are read from the repository instead
+    compile_infos[1].shaderStage = VSM_SHADER_FRAGMENT;
+    result = vsmCompileShader(context, &compile_infos[1]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "second", nullptr, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage == VSM_SHADER_FRAGMENT);
+    result = vsmRemoveShader(context, "first");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "second", nullptr, nullptr);
+    TEST_ASSERT(result != VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+    std::filesystem::remove(path);
+}
+
+void api::shader_handle()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "test",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "test",
+        nullptr,
+        0,
+    };
+    VsmShaderModuleHandleCreateInfo handle_info = {
+        VK_NULL_HANDLE,
+        VK_NULL_HANDLE,
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    VsmShader shader;
+    VsmShader other;
+    VkBool32 found;
+    VsmShaderStage stage;
+    uint32_t checksum;
+    size_t allocations;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+
+    result = vsmGetShaderHandle(nullptr, "test", &shader);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+    result = vsmGetShaderHandle(context, "test", nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // handles can be resolved before the shader is stored, and one name gives one handle
+    result = vsmGetShaderHandle(context, "test", &shader);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetShaderHandle(context, "test", &other);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(shader == other);
+    result = vsmQueryShaderHandle(context, shader, &found, &stage);
+    TEST_ASSERT(result != VSM_SUCCESS);
+
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    checksum = stub::last_code_checksum;
+    handle_info.shader = shader;
+    result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    found = VK_FALSE;
+    result = vsmQueryShaderHandle(context, shader, &found, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(found == VK_TRUE);
+    TEST_ASSERT(stage == VSM_SHADER_COMPUTE);
+
+    // resolved handles do not allocate
+    allocations = allocation_count;
+    for (int i = 0; i < 100 && result == VSM_SUCCESS; i++)
+    {
+        result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &module);
+        if (result == VSM_SUCCESS)
+        {
+            result = vsmQueryShaderHandle(context, shader, &found, &stage);
+        }
+    }
+    allocations = allocation_count - allocations;
+    TEST_ASSERT(allocations == 0);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // writes to the shader reset its handle
+    compile_info.shaderStage = VSM_SHADER_FRAGMENT;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShaderHandle(context, shader, &found, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage == VSM_SHADER_FRAGMENT);
+    result = vsmRemoveShader(context, "test");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShaderHandle(context, shader, &found, &stage);
+    TEST_ASSERT(result != VSM_SUCCESS);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::export_pack()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_export.pack").string();
+    VsmCodeEncodingCreateInfo encoding_info = {
+        VSM_STRUCTURE_TYPE_CODE_ENCODING_CREATE_INFO,
+        nullptr,
+        VSM_CODE_ENCODING_COMPACT,
+    };
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        nullptr,
+        VSM_REPOSITORY_FORMAT_PACK,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &encoding_info,
+    };
+    VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", shader_source.c_str(), VSM_SHADER_VERTEX},
+        {"third", shader_source.c_str(), VSM_SHADER_FRAGMENT},
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "second",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    VsmShaderStage stage;
+    VsmShaderReflection reflection = {};
+    VsmShaderReflection exported = {};
+    size_t size;
+    uint32_t checksum;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShaders(context, 3, compile_infos, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    size = stub::last_code_size;
+    checksum = stub::last_code_checksum;
+    result = vsmGetShaderReflection(context, "second", &reflection);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmExportPack(context, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmExportPack(context, path.c_str());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+
+    // the pack serves decoded code from the mapping
+    create_info.repositoryPath = path.c_str();
+    create_info.pNext = &repository_info;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_magic == 0x07230203);
+    TEST_ASSERT(stub::last_aligned);
+    TEST_ASSERT(stub::last_code_size == size);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    for (const VsmShaderCompileInfo &compile_info : compile_infos)
+    {
+        result = vsmQueryShader(context, compile_info.shaderName, nullptr, &stage);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stage == compile_info.shaderStage);
+    }
+    result = vsmQueryShader(context, "missing", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+
+    // reflection records are served from the mapping too
+    result = vsmGetShaderReflection(context, "second", &exported);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(memcmp(exported.localSize, reflection.localSize, sizeof(reflection.localSize)) == 0);
+    TEST_ASSERT(exported.pushConstantSize == reflection.pushConstantSize);
+    TEST_ASSERT(exported.bindingCount == reflection.bindingCount);
+    TEST_ASSERT(exported.inputCount == reflection.inputCount);
+    TEST_ASSERT(exported.outputCount == reflection.outputCount);
+
+    // packs are read only
+    result = vsmCompileShader(context, &compile_infos[0]);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_STORE);
+    result = vsmRemoveShader(context, "first");
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_REMOVE);
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_CLEAR);
+    vsmDestroyContext(context, nullptr);
+
+    // files that are not packs are rejected
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a pack file, but longer than its header";
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_INIT);
+    std::filesystem::remove(path);
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_OPEN);
+}
+
+static const VsmShaderCompileInfo conformance_shaders[] = {
+    {"vertex", shader_source.c_str(), VSM_SHADER_VERTEX},
+    {"fragment", shader_source.c_str(), VSM_SHADER_FRAGMENT},
+    {"compute", shader_source.c_str(), VSM_SHADER_COMPUTE},
+};
+
+void conformance::contents(VsmContext context, const VsmShaderCompileInfo *compile_infos, uint32_t count)
+{
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        nullptr,
+        nullptr,
+        0,
+    };
+    VsmResult result;
+    VkShaderModule module;
+    VkBool32 found;
+    VsmShaderStage stage;
+
+    for (uint32_t index = 0; index < count; index++)
+    {
+        found = VK_FALSE;
+        result = vsmQueryShader(context, compile_infos[index].shaderName, &found, &stage);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(found == VK_TRUE);
+        TEST_ASSERT(stage == compile_infos[index].shaderStage);
+        module_info.shaderName = compile_infos[index].shaderName;
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stub::last_magic == 0x07230203);
+        TEST_ASSERT(stub::last_aligned);
+    }
+
+    result = vsmQueryShader(context, "missing", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+    module_info.shaderName = "missing";
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+}
+
+void conformance::writes(VsmContext context)
+{
+    VsmShaderCompileInfo compile_infos[] = {
+        {"valid", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"invalid", invalid_source.c_str(), VSM_SHADER_COMPUTE},
+    };
+    VsmResult results[2];
+    VsmResult result;
+    VsmShaderStage stage;
+
+    result = vsmCompileShaders(context, 3, conformance_shaders, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    contents(context, conformance_shaders, 3);
+
+    // storing again replaces the shader
+    compile_infos[0].shaderName = "compute";
+    compile_infos[0].shaderStage = VSM_SHADER_GEOMETRY;
+    result = vsmCompileShader(context, &compile_infos[0]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "compute", nullptr, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage == VSM_SHADER_GEOMETRY);
+    result = vsmCompileShader(context, &conformance_shaders[2]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // failed entries of a batch leave the rest stored
+    compile_infos[0].shaderName = "valid";
+    result = vsmCompileShaders(context, 2, compile_infos, results);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PARSE);
+    TEST_ASSERT(results[0] == VSM_SUCCESS);
+    TEST_ASSERT(results[1] == VSM_ERROR_COMPILE_PARSE);
+    result = vsmQueryShader(context, "valid", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "invalid", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+
+    result = vsmRemoveShader(context, "valid");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmRemoveShader(context, "valid");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmQueryShader(context, "valid", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+    contents(context, conformance_shaders, 3);
+
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    contents(context, nullptr, 0);
+    for (const VsmShaderCompileInfo &compile_info : conformance_shaders)
+    {
+        result = vsmQueryShader(context, compile_info.shaderName, nullptr, nullptr);
+        TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+    }
+}
+
+void api::sqlite_backend()
+{
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        nullptr,
+        VSM_REPOSITORY_FORMAT_SQLITE,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &repository_info,
+    };
+    VsmContext context;
+    VsmResult result;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    conformance::writes(context);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::memory_backend()
+{
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        nullptr,
+        VSM_REPOSITORY_FORMAT_MEMORY,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &repository_info,
+    };
+    VsmContext context;
+    VsmResult result;
+
+    repository_info.format = VSM_REPOSITORY_FORMAT_MAX_ENUM;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_OPEN);
+
+    repository_info.format = VSM_REPOSITORY_FORMAT_MEMORY;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    conformance::writes(context);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::pack_backend()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_backend.pack").string();
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        nullptr,
+        VSM_REPOSITORY_FORMAT_MEMORY,
+    };
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &repository_info,
+    };
+    VsmShaderReflection reflections[3] = {};
+    VsmShaderReflection reflection = {};
+    VsmContext context;
+    VsmResult result;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShaders(context, 3, conformance_shaders, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        result = vsmGetShaderReflection(context, conformance_shaders[index].shaderName, &reflections[index]);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    }
+    result = vsmExportPack(context, path.c_str());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+
+    repository_info.format = VSM_REPOSITORY_FORMAT_PACK;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    conformance::contents(context, conformance_shaders, 3);
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        result = vsmGetShaderReflection(context, conformance_shaders[index].shaderName, &reflection);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(memcmp(reflection.localSize, reflections[index].localSize, sizeof(reflection.localSize)) == 0);
+        TEST_ASSERT(reflection.bindingCount == reflections[index].bindingCount);
+        TEST_ASSERT(reflection.inputCount == reflections[index].inputCount);
+        TEST_ASSERT(reflection.outputCount == reflections[index].outputCount);
+    }
+    result = vsmCompileShader(context, &conformance_shaders[0]);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_STORE);
+    result = vsmCompileShaders(context, 3, conformance_shaders, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_STORE);
+    result = vsmRemoveShader(context, "vertex");
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_REMOVE);
+    result = vsmClearShaders(context);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_CLEAR);
+    conformance::contents(context, conformance_shaders, 3);
+    vsmDestroyContext(context, nullptr);
+    std::filesystem::remove(path);
+}
+
+// counts finished jobs, optionally holding the worker until released
+struct async_state
+{
+    std::atomic<size_t> callbacks;
+    std::atomic<size_t> failures;
+    std::shared_future<void> release;
+};
+
+static void VKAPI_PTR async_callback(VsmJob job, VsmResult result, void *pUserData)
+{
+    async_state *state = static_cast<async_state *>(pUserData);
+    if (state->release.valid())
+    {
+        state->release.wait();
+    }
+    if (result != VSM_SUCCESS)
+    {
+        state->failures++;
+    }
+    state->callbacks++;
+}
+
+void api::compile_shader_async()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_infos[] = {
+        {"first", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", invalid_source.c_str(), VSM_SHADER_COMPUTE},
+        {"third", shader_source.c_str(), VSM_SHADER_VERTEX},
+    };
+    std::string name = "fourth";
+    VsmShaderCompileInfo copied_info = {
+        name.c_str(),
+        shader_source.c_str(),
+        VSM_SHADER_FRAGMENT,
+    };
+    std::promise<void> release;
+    async_state state = {{0}, {0}, release.get_future().share()};
+    VsmContext context;
+    VsmResult result;
+    VsmJob jobs[3];
+    VsmShaderStage stage;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+
+    result = vsmCompileShaderAsync(nullptr, &compile_infos[0], nullptr, nullptr, &jobs[0]);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+    result = vsmCompileShaderAsync(context, nullptr, nullptr, nullptr, &jobs[0]);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // jobs are not done until their callbacks return
+    for (int index = 0; index < 3; index++)
+    {
+        result = vsmCompileShaderAsync(context, &compile_infos[index], async_callback, &state, &jobs[index]);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    }
+    result = vsmPollJob(context, jobs[0]);
+    TEST_ASSERT(result == VSM_NOT_READY);
+    release.set_value();
+    result = vsmWaitForJobs(context, 3, jobs);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PARSE);
+    TEST_ASSERT(state.callbacks == 3);
+    TEST_ASSERT(state.failures == 1);
+    result = vsmPollJob(context, jobs[0]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmPollJob(context, jobs[1]);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PARSE);
+
+    // results are stored as vsmCompileShader stores them
+    result = vsmQueryShader(context, "third", nullptr, &stage);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage == VSM_SHADER_VERTEX);
+    result = vsmQueryShader(context, "second", nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+    for (VsmJob job : jobs)
+    {
+        result = vsmDestroyJob(context, job);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    }
+
+    // the compile info is copied, and jobs without a handle finish before the context is destroyed
+    result = vsmCompileShaderAsync(context, &copied_info, async_callback, &state, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    name.assign("overwritten");
+    result = vsmCompileShaderAsync(context, &compile_infos[0], nullptr, nullptr, &jobs[0]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmDestroyJob(context, jobs[0]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+    TEST_ASSERT(state.callbacks == 4);
+    TEST_ASSERT(state.failures == 1);
+}
+
+void api::concurrent_compile()
+{
+    static const int thread_count = 8;
+    static const int shader_count = 250;
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmContext contexts[2];
+    VsmResult result;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> failures(0);
+
+    result = vsmCreateContext(&create_info, nullptr, &contexts[0]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateContext(&create_info, nullptr, &contexts[1]);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // threads share both contexts, while short lived contexts come and go alongside them
+    for (int thread = 0; thread < thread_count; thread++)
+    {
+        threads.emplace_back([&, thread]()
+                             {
+                                 VsmContext local;
+                                 if (vsmCreateContext(&create_info, nullptr, &local) != VSM_SUCCESS)
+                                 {
+                                     failures++;
+                                     return;
+                                 }
+                                 for (int index = 0; index < shader_count; index++)
+                                 {
+                                     const std::string name = "shader_" + std::to_string(thread) + "_" + std::to_string(index);
+                                     const std::string source = shader_source + "// " + name + "\n";
+                                     const VsmShaderCompileInfo compile_info = {name.c_str(), source.c_str(), VSM_SHADER_COMPUTE};
+                                     if (vsmCompileShader(contexts[index % 2], &compile_info) != VSM_SUCCESS ||
+                                         vsmCompileShader(local, &compile_info) != VSM_SUCCESS)
+                                     {
+                                         failures++;
+                                     }
+                                 }
+                                 vsmDestroyContext(local, nullptr); });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    TEST_ASSERT(failures == 0);
+
+    for (int thread = 0; thread < thread_count; thread++)
+    {
+        for (int index = 0; index < shader_count; index++)
+        {
+            const std::string name = "shader_" + std::to_string(thread) + "_" + std::to_string(index);
+            if (vsmQueryShader(contexts[index % 2], name.c_str(), nullptr, nullptr) != VSM_SUCCESS)
+            {
+                failures++;
+            }
+        }
+    }
+    TEST_ASSERT(failures == 0);
+
+    vsmDestroyContext(contexts[0], nullptr);
+    vsmDestroyContext(contexts[1], nullptr);
+}
+
+void api::include_shader()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vsm_include";
+    const std::string include_path = directory.string();
+    const char *include_paths[] = {include_path.c_str()};
+    const PFN_vsmIncludeCallback callback = [](const char *pHeaderName, const char *pIncluderName, VkBool32 local, void *pUserData, const char **ppData, size_t *pSize) -> VkBool32
+    {
+        static const std::string generated = "const int generated = 1;\n";
+        if (std::string(pHeaderName) != "generated.glsl")
+        {
+            return VK_FALSE;
+        }
+        (*static_cast<int *>(pUserData))++;
+        *ppData = generated.data();
+        *pSize = generated.size();
+        return VK_TRUE;
+    };
+    int callback_count = 0;
+    VsmIncludeCreateInfo include_info = {
+        VSM_STRUCTURE_TYPE_INCLUDE_CREATE_INFO,
+        nullptr,
+        1,
+        include_paths,
+        callback,
+        &callback_count,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &include_info,
+    };
+    const std::string source =
+        "#version 430\n"
+        "#include <common.glsl>\n"
+        "#include \"generated.glsl\"\n"
+        "void main(){\n"
+        "}\n";
+    const std::string flattened =
+        "#version 430\n"
+        "const int common = 1;\n"
+        "const int nested = 1;\n"
+        "const int generated = 1;\n"
+        "void main(){\n"
+        "}\n";
+    VsmShaderCompileInfo compile_info = {
+        "included",
+        source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "included",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    uint32_t checksum;
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / "detail");
+    std::ofstream(directory / "common.glsl") << "const int common = 1;\n#include \"detail/nested.glsl\"\n";
+    std::ofstream(directory / "detail" / "nested.glsl") << "const int nested = 1;\n";
+
+    // the flattened source compiles to the same code as the one with includes, given the same
+    // includer, which enables the include extension for both
+    compile_info.shaderSource = flattened.c_str();
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    checksum = stub::last_code_checksum;
+    vsmDestroyContext(context, nullptr);
+
+    // without include paths or a callback the include cannot be resolved
+    create_info.pNext = nullptr;
+    compile_info.shaderSource = source.c_str();
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PREPROCESS);
+    vsmDestroyContext(context, nullptr);
+
+    create_info.pNext = &include_info;
+    include_info.includePathCount = 1;
+    include_info.ppIncludePaths = nullptr;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    include_info.ppIncludePaths = include_paths;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(callback_count == 1);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+
+    // an edited header is read again, so the shader picks up the change
+    std::ofstream(directory / "detail" / "nested.glsl") << "const int nested = 2;\n";
+    std::filesystem::last_write_time(directory / "detail" / "nested.glsl", std::filesystem::file_time_type::clock::now() + std::chrono::hours(1));
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_checksum != checksum);
+
+    compile_info.shaderSource = "#version 430\n#include \"missing.glsl\"\nvoid main(){\n}\n";
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_PREPROCESS);
+    vsmDestroyContext(context, nullptr);
+
+    std::filesystem::remove_all(directory);
+}
+
+void api::rebuild_stale()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vsm_rebuild";
+    const std::string include_path = directory.string();
+    const std::string repository_path = (directory / "shaders.db").string();
+    const char *include_paths[] = {include_path.c_str()};
+    // touched an hour ahead each time, so every edit changes the modification time
+    int edits = 0;
+    const auto edit = [&](const std::string &header, const std::string &contents)
+    {
+        std::ofstream(directory / header) << contents;
+        std::filesystem::last_write_time(directory / header, std::filesystem::file_time_type::clock::now() + std::chrono::hours(++edits));
+    };
+    VsmIncludeCreateInfo include_info = {
+        VSM_STRUCTURE_TYPE_INCLUDE_CREATE_INFO,
+        nullptr,
+        1,
+        include_paths,
+        nullptr,
+        nullptr,
+    };
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        &include_info,
+        VSM_REPOSITORY_FORMAT_SQLITE,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &repository_info,
+    };
+    const std::string first_source = "#version 430\n#include \"first.glsl\"\nvoid main(){\n}\n";
+    const std::string second_source = "#version 430\n#include \"second.glsl\"\nvoid main(){\n}\n";
+    const VsmShaderCompileInfo compile_infos[] = {
+        {"first", first_source.c_str(), VSM_SHADER_COMPUTE},
+        {"second", second_source.c_str(), VSM_SHADER_FRAGMENT},
+        {"plain", shader_source.c_str(), VSM_SHADER_VERTEX},
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "first",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    VsmShaderStage stage;
+    uint32_t rebuilt;
+    uint32_t checksum;
+
+    for (VsmRepositoryFormat format : {VSM_REPOSITORY_FORMAT_SQLITE, VSM_REPOSITORY_FORMAT_MEMORY})
+    {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        edit("first.glsl", "#include \"common.glsl\"\n");
+        edit("second.glsl", "const int second = 1;\n");
+        edit("common.glsl", "const int common = 1;\n");
+        repository_info.format = format;
+        create_info.repositoryPath = format == VSM_REPOSITORY_FORMAT_SQLITE ? repository_path.c_str() : nullptr;
+
+        result = vsmCreateContext(&create_info, nullptr, &context);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmCompileShaders(context, 3, compile_infos, nullptr);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmRebuildStale(nullptr, &rebuilt);
+        TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+        result = vsmRebuildStale(context, &rebuilt);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(rebuilt == 0);
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        checksum = stub::last_code_checksum;
+
+        // a header included through another header makes only the shader that includes it stale
+        edit("common.glsl", "const int common = 2;\n");
+        if (format == VSM_REPOSITORY_FORMAT_SQLITE)
+        {
+            vsmDestroyContext(context, nullptr);
+            result = vsmCreateContext(&create_info, nullptr, &context);
+            TEST_ASSERT(result == VSM_SUCCESS);
+        }
+        result = vsmRebuildStale(context, &rebuilt);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(rebuilt == 1);
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stub::last_code_checksum != checksum);
+        result = vsmRebuildStale(context, &rebuilt);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(rebuilt == 0);
+
+        // compiling the same source again notices the changed header as well
+        edit("common.glsl", "const int common = 3;\n");
+        checksum = stub::last_code_checksum;
+        result = vsmCompileShader(context, &compile_infos[0]);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stub::last_code_checksum != checksum);
+
+        // removed shaders are forgotten, and a header that is gone fails the rebuild
+        result = vsmRemoveShader(context, "first");
+        TEST_ASSERT(result == VSM_SUCCESS);
+        edit("common.glsl", "const int common = 4;\n");
+        std::filesystem::remove(directory / "second.glsl");
+        result = vsmRebuildStale(context, &rebuilt);
+        TEST_ASSERT(result == VSM_ERROR_COMPILE_PREPROCESS);
+        TEST_ASSERT(rebuilt == 0);
+        result = vsmQueryShader(context, "second", nullptr, &stage);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stage == VSM_SHADER_FRAGMENT);
+        vsmDestroyContext(context, nullptr);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+void api::compile_permutations()
+{
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderDefine defines[] = {
+        {"COMMON", nullptr},
+        {"VALUE", "1"},
+    };
+    VsmShaderCompileInfo compile_info = {
+        "material",
+        shader_source.c_str(),
+        VSM_SHADER_FRAGMENT,
+        0,
+        nullptr,
+    };
+    const char *shadow_values[] = {nullptr, "1"};
+    const char *quality_values[] = {"0", "1", "2"};
+    VsmShaderPermutationAxis axes[] = {
+        {"SHADOWS", 2, shadow_values},
+        {"QUALITY", 3, quality_values},
+    };
+    const VsmShaderPermutationInfo permutation_info = {
+        &compile_info,
+        2,
+        axes,
+    };
+    const std::string variants[] = {
+        "material,QUALITY=0",
+        "material,QUALITY=1",
+        "material,QUALITY=2",
+        "material,SHADOWS=1,QUALITY=0",
+        "material,SHADOWS=1,QUALITY=1",
+        "material,SHADOWS=1,QUALITY=2",
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "material",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VsmResult results[6];
+    VkShaderModule module;
+    VsmShaderStage stage;
+    uint32_t variant_count;
+    std::vector<uint32_t> checksums;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // defines change the code, and the same defines compile to the same code
+    for (uint32_t define_count : {0, 2, 1, 2})
+    {
+        compile_info.defineCount = define_count;
+        compile_info.pDefines = defines;
+        result = vsmCompileShader(context, &compile_info);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        checksums.push_back(stub::last_code_checksum);
+    }
+    TEST_ASSERT(checksums[0] != checksums[1]);
+    TEST_ASSERT(checksums[1] != checksums[2]);
+    TEST_ASSERT(checksums[1] == checksums[3]);
+
+    compile_info.pDefines = nullptr;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    defines[0].name = nullptr;
+    compile_info.pDefines = defines;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    defines[0].name = "COMMON";
+
+    result = vsmCompilePermutations(context, nullptr, &variant_count, results);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmCompilePermutations(context, &permutation_info, &variant_count, results);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(variant_count == 6);
+    checksums.clear();
+    for (size_t index = 0; index < variant_count; index++)
+    {
+        TEST_ASSERT(results[index] == VSM_SUCCESS);
+        result = vsmQueryShader(context, variants[index].c_str(), nullptr, &stage);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(stage == VSM_SHADER_FRAGMENT);
+        module_info.shaderName = variants[index].c_str();
+        result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+        TEST_ASSERT(result == VSM_SUCCESS);
+        TEST_ASSERT(std::find(checksums.begin(), checksums.end(), stub::last_code_checksum) == checksums.end());
+        checksums.push_back(stub::last_code_checksum);
+    }
+
+    // an axis without values leaves nothing to compile
+    axes[1].valueCount = 0;
+    result = vsmCompilePermutations(context, &permutation_info, &variant_count, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(variant_count == 0);
+    axes[1].ppValues = nullptr;
+    axes[1].valueCount = 3;
+    result = vsmCompilePermutations(context, &permutation_info, &variant_count, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::optimize_shader()
+{
+    const PFN_vsmPassTimingCallback timing = [](const char *pShaderName, const char *pPassName, uint64_t nanoseconds, void *pUserData)
+    {
+        if (std::string(pShaderName) == "optimized" && std::string(pPassName).rfind("--", 0) == 0)
+        {
+            (*static_cast<int *>(pUserData))++;
+        }
+    };
+    const char *custom_passes[] = {"--eliminate-dead-code-aggressive", "--merge-blocks"};
+    const char *invalid_passes[] = {"--bogus-pass"};
+    int timing_count = 0;
+    VsmOptimizationInfo optimization_info = {
+        VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO,
+        nullptr,
+        VSM_OPTIMIZATION_PERFORMANCE,
+        0,
+        nullptr,
+        timing,
+        &timing_count,
+    };
+    VsmOptimizationInfo override_info = {
+        VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO,
+        nullptr,
+        VSM_OPTIMIZATION_NONE,
+        0,
+        nullptr,
+        nullptr,
+        nullptr,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "optimized",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+        0,
+        nullptr,
+        nullptr,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "optimized",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    size_t size;
+    uint32_t checksum;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    size = stub::last_code_size;
+    checksum = stub::last_code_checksum;
+    vsmDestroyContext(context, nullptr);
+
+    // the context's default runs each pass on its own, reporting its time
+    create_info.pNext = &optimization_info;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(timing_count > 1);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size < size);
+
+    // a compile can override the default, and the stored code follows the passes it ran
+    compile_info.pNext = &override_info;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size == size);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+
+    override_info.level = VSM_OPTIMIZATION_CUSTOM;
+    override_info.passCount = 2;
+    override_info.ppPasses = custom_passes;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size < size);
+
+    override_info.passCount = 1;
+    override_info.ppPasses = invalid_passes;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_OPTIMIZE);
+    override_info.ppPasses = nullptr;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    vsmDestroyContext(context, nullptr);
+
+    optimization_info.level = VSM_OPTIMIZATION_MAX_ENUM;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_ERROR_COMPILE_OPTIMIZE);
+}
+
+void api::tiered_optimization()
+{
+    // the optimizing worker waits in its first pass until the test lets it go
+    struct gate
+    {
+        std::shared_future<void> released;
+    };
+    const PFN_vsmPassTimingCallback timing = [](const char *pShaderName, const char *pPassName, uint64_t nanoseconds, void *pUserData)
+    {
+        static_cast<gate *>(pUserData)->released.wait();
+    };
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_tiered.db").string();
+    gate gate;
+    VsmOptimizationInfo optimization_info = {
+        VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO,
+        nullptr,
+        VSM_OPTIMIZATION_PERFORMANCE,
+        0,
+        nullptr,
+        timing,
+        &gate,
+        VK_TRUE,
+    };
+    VsmOptimizationInfo override_info = {
+        VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO,
+        nullptr,
+        VSM_OPTIMIZATION_NONE,
+        0,
+        nullptr,
+        nullptr,
+        nullptr,
+        VK_FALSE,
+    };
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &optimization_info,
+    };
+    VsmShaderDefine define = {"TIERED", "1"};
+    VsmShaderCompileInfo compile_info = {
+        "tiered",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+        0,
+        nullptr,
+        nullptr,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "tiered",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    uint64_t generation;
+    size_t size;
+    uint32_t checksum;
+    std::promise<void> release;
+
+    std::filesystem::remove(path);
+    gate.released = release.get_future().share();
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // glslang's code is usable at once, while the worker is held back
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetShaderGeneration(context, "tiered", &generation);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(generation == 0);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    size = stub::last_code_size;
+
+    // the optimized code is swapped in once the worker is done
+    release.set_value();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        result = vsmGetShaderGeneration(context, "tiered", &generation);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    } while (generation == 0 && std::chrono::steady_clock::now() < deadline);
+    TEST_ASSERT(generation == 1);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size < size);
+
+    result = vsmGetShaderGeneration(context, "missing", &generation);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_QUERY);
+    result = vsmGetShaderGeneration(context, "tiered", nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmRemoveShader(context, "tiered");
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // a shader written while its optimization runs keeps the newer code
+    release = std::promise<void>();
+    gate.released = release.get_future().share();
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    compile_info.defineCount = 1;
+    compile_info.pDefines = &define;
+    compile_info.pNext = &override_info;
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    checksum = stub::last_code_checksum;
+    release.set_value();
+    // destroying the context waits for the worker
+    vsmDestroyContext(context, nullptr);
+
+    create_info.pNext = nullptr;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetShaderGeneration(context, "tiered", &generation);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(generation == 1);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    vsmDestroyContext(context, nullptr);
+
+    // an async compile still queued behind held workers runs, and queues its optimization, while
+    // the context is destroyed
+    release = std::promise<void>();
+    gate.released = release.get_future().share();
+    create_info.pNext = &optimization_info;
+    compile_info.defineCount = 0;
+    compile_info.pDefines = nullptr;
+    compile_info.pNext = nullptr;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    for (unsigned index = 0; index < std::max(std::thread::hardware_concurrency(), 1u); index++)
+    {
+        const std::string name = "held" + std::to_string(index);
+        compile_info.shaderName = name.c_str();
+        result = vsmCompileShader(context, &compile_info);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    }
+    compile_info.shaderName = "queued";
+    result = vsmCompileShaderAsync(context, &compile_info, nullptr, nullptr, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    std::thread releaser([&release]()
+                         {
+                             std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                             release.set_value(); });
+    vsmDestroyContext(context, nullptr);
+    releaser.join();
+
+    create_info.pNext = nullptr;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmGetShaderGeneration(context, "queued", &generation);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(generation == 1);
+    vsmDestroyContext(context, nullptr);
+    std::filesystem::remove(path);
+}
+
+void api::debug_info()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_debug_info.db").string();
+    const std::string pack_path = (std::filesystem::temp_directory_path() / "vsm_debug_info.pack").string();
+    VsmDebugInfoCreateInfo debug_info = {
+        VSM_STRUCTURE_TYPE_DEBUG_INFO_CREATE_INFO,
+        nullptr,
+        VK_TRUE,
+    };
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        &debug_info,
+        VSM_REPOSITORY_FORMAT_MEMORY,
+    };
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "debug",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        VK_NULL_HANDLE,
+        "debug",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule module;
+    size_t size;
+    uint32_t checksum;
+    size_t debug_size;
+    uint32_t debug_checksum;
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(pack_path);
+
+    // release loads leave the debug instructions out
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    size = stub::last_code_size;
+    checksum = stub::last_code_checksum;
+    vsmDestroyContext(context, nullptr);
+
+    // the repository kept them, so a debug load of the same shader puts them back
+    create_info.pNext = &debug_info;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    debug_size = stub::last_code_size;
+    debug_checksum = stub::last_code_checksum;
+    TEST_ASSERT(debug_size > size);
+
+    // exported packs are release code
+    result = vsmExportPack(context, pack_path.c_str());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+    repository_info.format = VSM_REPOSITORY_FORMAT_PACK;
+    create_info.repositoryPath = pack_path.c_str();
+    create_info.pNext = &repository_info;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size == size);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    vsmDestroyContext(context, nullptr);
+
+    // the memory repository splits the code the same way
+    repository_info.format = VSM_REPOSITORY_FORMAT_MEMORY;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size == debug_size);
+    TEST_ASSERT(stub::last_code_checksum == debug_checksum);
+    vsmDestroyContext(context, nullptr);
+    repository_info.pNext = nullptr;
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShader(context, &compile_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::last_code_size == size);
+    TEST_ASSERT(stub::last_code_checksum == checksum);
+    vsmDestroyContext(context, nullptr);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(pack_path);
+}
+
+void api::shader_reflection()
+{
+    const std::string compute_source =
+        "#version 450\n"
+        "layout(local_size_x = 8, local_size_y = 4) in;\n"
+        "layout(set = 0, binding = 0) uniform Params { vec4 scale; } params;\n"
+        "layout(set = 0, binding = 1, rgba8) uniform writeonly image2D images[2];\n"
+        "layout(set = 1, binding = 0) buffer Data { float values[]; } data;\n"
+        "layout(push_constant) uniform Push { uint first; uint count; } push;\n"
+        "void main(){\n"
+        "    uint index = push.first + gl_GlobalInvocationID.x;\n"
+        "    if (index < push.count) {\n"
+        "        data.values[index] *= params.scale.x;\n"
+        "        imageStore(images[index % 2], ivec2(gl_GlobalInvocationID.xy), params.scale);\n"
+        "    }\n"
+        "}\n";
+    const std::string vertex_source =
+        "#version 450\n"
+        "layout(location = 0) in vec3 position;\n"
+        "layout(location = 1) in vec2 uv;\n"
+        "layout(location = 0) out vec2 out_uv;\n"
+        "void main(){\n"
+        "    out_uv = uv;\n"
+        "    gl_Position = vec4(position, 1.0);\n"
+        "}\n";
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_infos[] = {
+        {"reflected", compute_source.c_str(), VSM_SHADER_COMPUTE},
+        {"vertex", vertex_source.c_str(), VSM_SHADER_VERTEX},
+    };
+    VsmShaderBinding bindings[4];
+    VsmShaderInterfaceVariable inputs[4];
+    VsmShaderInterfaceVariable outputs[4];
+    VsmShaderReflection reflection = {};
+    VsmContext context;
+    VsmResult result;
+    size_t allocations;
+
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCompileShaders(context, 2, compile_infos, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // without arrays only the counts are set
+    result = vsmGetShaderReflection(context, "reflected", &reflection);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(reflection.localSize[0] == 8 && reflection.localSize[1] == 4 && reflection.localSize[2] == 1);
+    TEST_ASSERT(reflection.pushConstantOffset == 0);
+    TEST_ASSERT(reflection.pushConstantSize == 8);
+    TEST_ASSERT(reflection.bindingCount == 3);
+    TEST_ASSERT(reflection.inputCount == 0);
+    TEST_ASSERT(reflection.outputCount == 0);
+
+    // reading the record does not allocate
+    reflection.pBindings = bindings;
+    allocations = allocation_count;
+    result = vsmGetShaderReflection(context, "reflected", &reflection);
+    allocations = allocation_count - allocations;
+    TEST_ASSERT(allocations == 0);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(reflection.bindingCount == 3);
+    TEST_ASSERT(bindings[0].set == 0 && bindings[0].binding == 0);
+    TEST_ASSERT(bindings[0].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && bindings[0].descriptorCount == 1);
+    TEST_ASSERT(bindings[1].set == 0 && bindings[1].binding == 1);
+    TEST_ASSERT(bindings[1].descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && bindings[1].descriptorCount == 2);
+    TEST_ASSERT(bindings[2].set == 1 && bindings[2].binding == 0);
+    TEST_ASSERT(bindings[2].descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && bindings[2].descriptorCount == 1);
+
+    // a short array is filled as far as it goes
+    reflection.bindingCount = 2;
+    result = vsmGetShaderReflection(context, "reflected", &reflection);
+    TEST_ASSERT(result == VSM_INCOMPLETE);
+    TEST_ASSERT(reflection.bindingCount == 2);
+
+    // built in variables take no location
+    reflection = {};
+    reflection.inputCount = 4;
+    reflection.pInputs = inputs;
+    reflection.outputCount = 4;
+    reflection.pOutputs = outputs;
+    result = vsmGetShaderReflection(context, "vertex", &reflection);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(reflection.localSize[0] == 1 && reflection.localSize[1] == 1 && reflection.localSize[2] == 1);
+    TEST_ASSERT(reflection.pushConstantSize == 0);
+    TEST_ASSERT(reflection.bindingCount == 0);
+    TEST_ASSERT(reflection.inputCount == 2);
+    TEST_ASSERT(inputs[0].location == 0 && inputs[0].format == VK_FORMAT_R32G32B32_SFLOAT);
+    TEST_ASSERT(inputs[1].location == 1 && inputs[1].format == VK_FORMAT_R32G32_SFLOAT);
+    TEST_ASSERT(reflection.outputCount == 1);
+    TEST_ASSERT(outputs[0].location == 0 && outputs[0].format == VK_FORMAT_R32G32_SFLOAT);
+
+    result = vsmGetShaderReflection(context, "missing", &reflection);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    result = vsmGetShaderReflection(context, "vertex", nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::module_cache()
+{
+    const std::string updated_source = "#version 450\nlayout(local_size_x = 2) in;\nvoid main(){}\n";
+    const VkDevice first_device = reinterpret_cast<VkDevice>(uintptr_t(1));
+    const VkDevice second_device = reinterpret_cast<VkDevice>(uintptr_t(2));
+    VsmModuleCacheCreateInfo module_cache_info = {
+        VSM_STRUCTURE_TYPE_MODULE_CACHE_CREATE_INFO,
+        nullptr,
+        VK_TRUE,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+        &module_cache_info,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "shared",
+        shader_source.c_str(),
+        VSM_SHADER_COMPUTE,
+    };
+    VsmShaderModuleCreateInfo module_info = {
+        first_device,
+        "shared",
+        nullptr,
+        0,
+    };
+    VsmContext context;
+    VsmResult result;
+    VkShaderModule first;
+    VkShaderModule second;
+    VkShaderModule other;
+    VkShaderModule owned;
+    VkShaderModule by_handle;
+    VsmShaderModuleHandleCreateInfo handle_info = {
+        first_device,
+        VK_NULL_HANDLE,
+        nullptr,
+        0,
+    };
+    size_t creates;
+    size_t destroys;
+    size_t allocations;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+
+    // repeated requests share one module
+    creates = stub::create_module_count;
+    destroys = stub::destroy_module_count;
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &first);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    allocations = allocation_count;
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &second);
+    allocations = allocation_count - allocations;
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(allocations == 0);
+    TEST_ASSERT(second == first);
+    TEST_ASSERT(stub::create_module_count == creates + 1);
+
+    // every device gets its own module
+    module_info.device = second_device;
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &other);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(other != first);
+    TEST_ASSERT(stub::create_module_count == creates + 2);
+
+    // a module created by handle is the same shared module, released the same way
+    result = vsmGetShaderHandle(context, "shared", &handle_info.shader);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModuleFromHandle(context, &handle_info, nullptr, &by_handle);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(by_handle == first);
+    TEST_ASSERT(stub::create_module_count == creates + 2);
+    result = vsmReleaseShaderModule(context, first_device, by_handle, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys);
+
+    // flags make the module the caller's own
+    module_info.device = first_device;
+    module_info.flags = 1;
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &owned);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(owned != first);
+    result = vsmReleaseShaderModule(context, first_device, owned, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 1 && stub::last_destroyed == owned);
+    module_info.flags = 0;
+
+    // the module is destroyed with its last reference
+    result = vsmReleaseShaderModule(context, first_device, first, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 1);
+    result = vsmReleaseShaderModule(context, first_device, second, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 2 && stub::last_destroyed == first);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &first);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::create_module_count == creates + 4);
+
+    // a recompile retires the module, which stays alive until it is released
+    compile_info.shaderSource = updated_source.c_str();
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &second);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(second != first);
+    TEST_ASSERT(stub::create_module_count == creates + 5);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 2);
+    result = vsmReleaseShaderModule(context, first_device, first, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 3 && stub::last_destroyed == first);
+
+    // so does removing the shader
+    result = vsmRemoveShader(context, "shared");
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModule(context, &module_info, nullptr, &first);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    result = vsmReleaseShaderModule(context, first_device, second, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 4 && stub::last_destroyed == second);
+
+    result = vsmReleaseShaderModule(nullptr, first_device, second, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+
+    // modules still referenced are destroyed with the context
+    vsmDestroyContext(context, nullptr);
+    TEST_ASSERT(stub::destroy_module_count == destroys + 5 && stub::last_destroyed == other);
+}
+
+void api::pipeline_cache()
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "vsm_pipeline_cache.db").string();
+    VsmRepositoryCreateInfo repository_info = {
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO,
+        nullptr,
+        VSM_REPOSITORY_FORMAT_MEMORY,
+    };
+    VsmContextCreateInfo create_info = {
+        path.c_str(),
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VkPhysicalDeviceProperties first_properties = {};
+    VkPhysicalDeviceProperties second_properties = {};
+    const auto make_data = [](const VkPhysicalDeviceProperties &properties, uint8_t fill, size_t payload)
+    {
+        VkPipelineCacheHeaderVersionOne header = {
+            sizeof(VkPipelineCacheHeaderVersionOne),
+            VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
+            properties.vendorID,
+            properties.deviceID,
+        };
+        memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        std::vector<uint8_t> data(sizeof(header) + payload, fill);
+        memcpy(data.data(), &header, sizeof(header));
+        return data;
+    };
+    std::vector<uint8_t> first_data;
+    std::vector<uint8_t> second_data;
+    std::vector<uint8_t> loaded;
+    std::vector<uint8_t> merged_data;
+    const VkDevice device = reinterpret_cast<VkDevice>(uintptr_t(1));
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        nullptr,
+        0,
+    };
+    VkPipelineCache cache;
+    VkPhysicalDeviceProperties third_properties;
+    VsmContext context;
+    VsmResult result;
+    size_t size;
+    size_t caches;
+
+    first_properties.vendorID = 0x10005;
+    first_properties.deviceID = 1;
+    memset(first_properties.pipelineCacheUUID, 0xA1, VK_UUID_SIZE);
+    second_properties = first_properties;
+    second_properties.pipelineCacheUUID[0] = 0xB2;
+    third_properties = first_properties;
+    third_properties.deviceID = 3;
+    first_data = make_data(first_properties, 1, 64);
+    second_data = make_data(second_properties, 2, 16);
+
+    std::filesystem::remove(path);
+    result = vsmCreateContext(&create_info, nullptr, &context);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    // nothing is stored for a new device
+    size = 1;
+    result = vsmLoadPipelineCache(context, &first_properties, &size, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(size == 0);
+
+    // data without a valid header is rejected
+    result = vsmStorePipelineCache(context, 16, first_data.data());
+    TEST_ASSERT(result == VSM_ERROR_PIPELINE_CACHE);
+    loaded = first_data;
+    loaded[4] = 2;
+    result = vsmStorePipelineCache(context, loaded.size(), loaded.data());
+    TEST_ASSERT(result == VSM_ERROR_PIPELINE_CACHE);
+    loaded = first_data;
+    loaded[0] = 0xFF;
+    result = vsmStorePipelineCache(context, loaded.size(), loaded.data());
+    TEST_ASSERT(result == VSM_ERROR_PIPELINE_CACHE);
+    result = vsmStorePipelineCache(context, 0, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // each driver build keeps its own data
+    result = vsmStorePipelineCache(context, first_data.size(), first_data.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmStorePipelineCache(context, second_data.size(), second_data.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+
+    // the data outlives the context
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    result = vsmLoadPipelineCache(context, &first_properties, &size, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(size == first_data.size());
+    loaded.assign(size - 1, 0);
+    size = loaded.size();
+    result = vsmLoadPipelineCache(context, &first_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_INCOMPLETE);
+    TEST_ASSERT(size == first_data.size());
+    TEST_ASSERT(std::all_of(loaded.begin(), loaded.end(), [](uint8_t byte) { return byte == 0; }));
+    loaded.assign(size, 0);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(loaded == first_data);
+    result = vsmLoadPipelineCache(context, &second_properties, &size, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(size == second_data.size());
+
+    // storing again replaces the data for that device alone
+    first_data = make_data(first_properties, 3, 128);
+    result = vsmStorePipelineCache(context, first_data.size(), first_data.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmStorePipelineCache(context, first_data.size(), first_data.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, nullptr);
+    TEST_ASSERT(size == first_data.size());
+    loaded.assign(size, 0);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(loaded == first_data);
+    result = vsmLoadPipelineCache(context, &second_properties, &size, nullptr);
+    TEST_ASSERT(size == second_data.size());
+
+    // other vendors see nothing
+    second_properties.vendorID = 0x1002;
+    result = vsmLoadPipelineCache(context, &second_properties, &size, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(size == 0);
+    result = vsmLoadPipelineCache(context, nullptr, &size, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // merging keeps the stored entries and adds the cache's own
+    merged_data = make_data(first_properties, 4, 32);
+    cache_info.initialDataSize = merged_data.size();
+    cache_info.pInitialData = merged_data.data();
+    static_cast<void>(vkCreatePipelineCache(device, &cache_info, nullptr, &cache));
+    caches = stub::pipeline_caches.size();
+    result = vsmMergePipelineCache(context, device, cache, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stub::pipeline_caches.size() == caches);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, nullptr);
+    TEST_ASSERT(size == first_data.size() + 32);
+    loaded.assign(size, 0);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(std::equal(first_data.begin(), first_data.end(), loaded.begin()));
+    TEST_ASSERT(std::all_of(loaded.begin() + first_data.size(), loaded.end(), [](uint8_t byte) { return byte == 4; }));
+    vkDestroyPipelineCache(device, cache, nullptr);
+
+    // a device with nothing stored gets the cache's data as it is
+    merged_data = make_data(third_properties, 5, 8);
+    cache_info.initialDataSize = merged_data.size();
+    cache_info.pInitialData = merged_data.data();
+    static_cast<void>(vkCreatePipelineCache(device, &cache_info, nullptr, &cache));
+    result = vsmMergePipelineCache(context, device, cache, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    loaded.assign(merged_data.size(), 0);
+    size = loaded.size();
+    result = vsmLoadPipelineCache(context, &third_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(loaded == merged_data);
+    vkDestroyPipelineCache(device, cache, nullptr);
+    result = vsmMergePipelineCache(context, device, VK_NULL_HANDLE, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    vsmDestroyContext(context, nullptr);
+    std::filesystem::remove(path);
+
+    // the memory repository keeps data for as long as the context
+    create_info.pNext = &repository_info;
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    result = vsmStorePipelineCache(context, second_data.size(), second_data.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    second_properties.vendorID = first_properties.vendorID;
+    loaded.assign(second_data.size(), 0);
+    size = loaded.size();
+    result = vsmLoadPipelineCache(context, &second_properties, &size, loaded.data());
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(loaded == second_data);
+    result = vsmLoadPipelineCache(context, &first_properties, &size, nullptr);
+    TEST_ASSERT(size == 0);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::create_shader_modules()
+{
+    const VkDevice device = reinterpret_cast<VkDevice>(uintptr_t(1));
+    const char *const names[] = {"batch_a", "batch_b", "missing", "batch_c"};
+    VsmModuleCacheCreateInfo module_cache_info = {
+        VSM_STRUCTURE_TYPE_MODULE_CACHE_CREATE_INFO,
+        nullptr,
+        VK_TRUE,
+    };
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_2,
+        VSM_SPV_1_5,
+    };
+    VsmShaderCompileInfo compile_infos[3] = {
+        {"batch_a", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"batch_b", shader_source.c_str(), VSM_SHADER_COMPUTE},
+        {"batch_c", shader_source.c_str(), VSM_SHADER_COMPUTE},
+    };
+    VsmShaderModuleCreateInfo module_infos[4];
+    VkShaderModule modules[4];
+    VsmResult results[4];
+    VkShaderModule module;
+    VsmContext context;
+    VsmResult result;
+    size_t creates;
+    size_t destroys;
+
+    for (size_t index = 0; index < 4; index++)
+    {
+        module_infos[index] = {device, names[index], nullptr, 0};
+    }
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShaders(context, 3, compile_infos, nullptr));
+
+    // every entry reports its own result
+    creates = stub::create_module_count;
+    result = vsmCreateShaderModules(context, 4, module_infos, nullptr, modules, results);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    TEST_ASSERT(results[0] == VSM_SUCCESS && results[1] == VSM_SUCCESS && results[3] == VSM_SUCCESS);
+    TEST_ASSERT(results[2] == VSM_ERROR_REPOSITORY_LOAD);
+    TEST_ASSERT(modules[0] != VK_NULL_HANDLE && modules[1] != VK_NULL_HANDLE && modules[3] != VK_NULL_HANDLE);
+    TEST_ASSERT(modules[0] != modules[1] && modules[1] != modules[3] && modules[0] != modules[3]);
+    TEST_ASSERT(modules[2] == VK_NULL_HANDLE);
+    TEST_ASSERT(stub::create_module_count == creates + 3);
+
+    result = vsmCreateShaderModules(context, 2, module_infos, nullptr, modules, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModules(context, 0, nullptr, nullptr, nullptr, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmCreateShaderModules(context, 1, module_infos, nullptr, nullptr, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    result = vsmCreateShaderModules(nullptr, 1, module_infos, nullptr, modules, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_INVALID_CONTEXT);
+    vsmDestroyContext(context, nullptr);
+
+    // shared modules that already exist are handed out without touching the driver
+    create_info.pNext = &module_cache_info;
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShaders(context, 3, compile_infos, nullptr));
+    result = vsmCreateShaderModule(context, &module_infos[1], nullptr, &module);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    creates = stub::create_module_count;
+    destroys = stub::destroy_module_count;
+    module_infos[2] = module_infos[0];
+    result = vsmCreateShaderModules(context, 4, module_infos, nullptr, modules, results);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(modules[1] == module);
+    TEST_ASSERT(modules[2] == modules[0]);
+    TEST_ASSERT(stub::create_module_count <= creates + 3);
+    for (size_t index = 0; index < 4; index++)
+    {
+        result = vsmReleaseShaderModule(context, device, modules[index], nullptr);
+        TEST_ASSERT(result == VSM_SUCCESS);
+    }
+    result = vsmReleaseShaderModule(context, device, module, nullptr);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    // every module the driver created was destroyed, whichever entry created it first
+    TEST_ASSERT(stub::destroy_module_count - destroys == stub::create_module_count - creates + 1);
+    vsmDestroyContext(context, nullptr);
+}
+
+void api::pipeline_shader_stage()
+{
+    const std::string updated_source = "#version 450\nlayout(local_size_x = 2) in;\nvoid main(){}\n";
+    VsmContextCreateInfo create_info = {
+        nullptr,
+        false,
+        VSM_VULKAN_1_3,
+        VSM_SPV_1_6,
+    };
+    VsmShaderCompileInfo compile_info = {
+        "inline",
+        shader_source.c_str(),
+        VSM_SHADER_FRAGMENT,
+    };
+    const auto checksum = [](const VkShaderModuleCreateInfo &module_info)
+    {
+        uint32_t result = 0;
+        for (size_t index = 0; index < module_info.codeSize / sizeof(uint32_t); index++)
+        {
+            result = result * 31 + module_info.pCode[index];
+        }
+        return result;
+    };
+    VkPipelineShaderStageCreateInfo stage_info;
+    VkShaderModuleCreateInfo module_info;
+    VkPipelineShaderStageCreateInfo repeated_stage_info;
+    VkShaderModuleCreateInfo repeated_module_info;
+    VkPipelineShaderStageCreateInfo updated_stage_info;
+    VkShaderModuleCreateInfo updated_module_info;
+    VsmContext context;
+    VsmResult result;
+    size_t creates;
+    size_t allocations;
+    uint32_t code_checksum;
+
+    static_cast<void>(vsmCreateContext(&create_info, nullptr, &context));
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+
+    // the stage carries the code inline, without a module
+    creates = stub::create_module_count;
+    result = vsmGetPipelineShaderStageCreateInfo(context, "inline", &stage_info, &module_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(stage_info.sType == VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO);
+    TEST_ASSERT(stage_info.pNext == &module_info);
+    TEST_ASSERT(stage_info.stage == VK_SHADER_STAGE_FRAGMENT_BIT);
+    TEST_ASSERT(stage_info.module == VK_NULL_HANDLE);
+    TEST_ASSERT(std::string(stage_info.pName) == "main");
+    TEST_ASSERT(module_info.sType == VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO);
+    TEST_ASSERT(module_info.codeSize > 0 && module_info.codeSize % sizeof(uint32_t) == 0);
+    TEST_ASSERT(module_info.pCode[0] == 0x07230203);
+    TEST_ASSERT(stub::create_module_count == creates);
+    code_checksum = checksum(module_info);
+
+    // handing the same code out again neither copies nor allocates
+    allocations = allocation_count;
+    result = vsmGetPipelineShaderStageCreateInfo(context, "inline", &repeated_stage_info, &repeated_module_info);
+    allocations = allocation_count - allocations;
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(allocations == 0);
+    TEST_ASSERT(repeated_module_info.pCode == module_info.pCode);
+    TEST_ASSERT(repeated_stage_info.pNext == &repeated_module_info);
+
+    // code handed out stays valid after the shader is written again
+    compile_info.shaderSource = updated_source.c_str();
+    compile_info.shaderStage = VSM_SHADER_COMPUTE;
+    static_cast<void>(vsmCompileShader(context, &compile_info));
+    result = vsmGetPipelineShaderStageCreateInfo(context, "inline", &updated_stage_info, &updated_module_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(updated_stage_info.stage == VK_SHADER_STAGE_COMPUTE_BIT);
+    TEST_ASSERT(updated_module_info.pCode != module_info.pCode);
+    TEST_ASSERT(checksum(module_info) == code_checksum);
+    result = vsmReleasePipelineShaderStageCreateInfo(context, &stage_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    TEST_ASSERT(checksum(repeated_module_info) == code_checksum);
+    result = vsmReleasePipelineShaderStageCreateInfo(context, &repeated_stage_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    result = vsmReleasePipelineShaderStageCreateInfo(context, &updated_stage_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+
+    result = vsmGetPipelineShaderStageCreateInfo(context, "missing", &stage_info, &module_info);
+    TEST_ASSERT(result == VSM_ERROR_REPOSITORY_LOAD);
+    result = vsmGetPipelineShaderStageCreateInfo(context, "inline", &stage_info, nullptr);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+    stage_info.pNext = nullptr;
+    result = vsmReleasePipelineShaderStageCreateInfo(context, &stage_info);
+    TEST_ASSERT(result == VSM_ERROR_NULL_HANDLE);
+
+    // stages still held when the context is destroyed are released with it
+    result = vsmGetPipelineShaderStageCreateInfo(context, "inline", &stage_info, &module_info);
+    TEST_ASSERT(result == VSM_SUCCESS);
+    vsmDestroyContext(context, nullptr);
+}
@@ -66,8 +66,30 @@ extern "C"
         VSM_ERROR_COMPILE_PARSE,
         VSM_ERROR_COMPILE_LINK,
         VSM_ERROR_CREATE_MODULE,
+        VSM_ERROR_CODE_ENCODING,
+        VSM_NOT_READY,
+        VSM_ERROR_COMPILE_OPTIMIZE,
+        VSM_INCOMPLETE,
+        VSM_ERROR_PIPELINE_CACHE,
+        VSM_ERROR_COMPILER_INIT,
     } VsmResult;
 
+    /**
+     * @brief VSM structure types, used to identify structures chained through pNext
+     */
+    typedef enum
+    {
+        VSM_STRUCTURE_TYPE_CODE_ENCODING_CREATE_INFO = 1,
+        VSM_STRUCTURE_TYPE_CACHE_CREATE_INFO = 2,
+        VSM_STRUCTURE_TYPE_PRELOAD_CREATE_INFO = 3,
+        VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO = 4,
+        VSM_STRUCTURE_TYPE_INCLUDE_CREATE_INFO = 5,
+        VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO = 6,
+        VSM_STRUCTURE_TYPE_DEBUG_INFO_CREATE_INFO = 7,
+        VSM_STRUCTURE_TYPE_MODULE_CACHE_CREATE_INFO = 8,
+        VSM_STRUCTURE_TYPE_MAX_ENUM = 0x7FFFFFFF,
+    } VsmStructureType;
+
     /**
      * @brief VSM Vulkan versions
      */
@@ -117,8 +139,43 @@ extern "C"
         VSM_SHADER_MAX_ENUM,
     } VsmShaderStage;
 
+    /**
+     * @brief VSM stored code encodings
+     */
+    typedef enum
+    {
+        VSM_CODE_ENCODING_RAW,
+        VSM_CODE_ENCODING_VARINT,
+        VSM_CODE_ENCODING_COMPACT,
+        VSM_CODE_ENCODING_MAX_ENUM,
+    } VsmCodeEncoding;
+
+    /**
+     * @brief VSM repository formats
+     */
+    typedef enum
+    {
+        VSM_REPOSITORY_FORMAT_SQLITE,
+        VSM_REPOSITORY_FORMAT_PACK,
+        VSM_REPOSITORY_FORMAT_MEMORY,
+        VSM_REPOSITORY_FORMAT_MAX_ENUM,
+    } VsmRepositoryFormat;
+
+    /**
+     * @brief VSM SPIR-V optimization levels
+     */
+    typedef enum
+    {
+        VSM_OPTIMIZATION_NONE,
+        VSM_OPTIMIZATION_PERFORMANCE,
+        VSM_OPTIMIZATION_SIZE,
+        VSM_OPTIMIZATION_CUSTOM,
+        VSM_OPTIMIZATION_MAX_ENUM,
+    } VsmOptimizationLevel;
+
     /**
      * @brief VSM context create info
+     * @param pNext NULL or a pointer to a VSM extension structure
      */
     typedef struct VsmContextCreateInfo
     {
@@ -126,21 +183,301 @@ extern "C"
         bool shared;
         VsmVulkanVersion vulkanVersion;
         VsmSPVVersion spvVersion;
+        const void *pNext;
     } VsmContextCreateInfo;
 
+    /**
+     * @brief VSM code encoding create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_CODE_ENCODING_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param encoding How code stored by this context is encoded. VSM_CODE_ENCODING_VARINT
+     * stores each word as a varint, VSM_CODE_ENCODING_COMPACT additionally packs SPIR-V
+     * instructions by opcode and delta codes their ids for a smaller result. Code is decoded
+     * on load whatever encoding the storing context used.
+     */
+    typedef struct VsmCodeEncodingCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VsmCodeEncoding encoding;
+    } VsmCodeEncodingCreateInfo;
+
+    /**
+     * @brief VSM cache create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_CACHE_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param cacheSize The number of bytes of decoded code the context keeps in memory, evicting
+     * the least recently used shaders first. Zero, the default, disables the cache.
+     */
+    typedef struct VsmCacheCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        size_t cacheSize;
+    } VsmCacheCreateInfo;
+
+    /**
+     * @brief VSM preload create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_PRELOAD_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param preload Whether the context reads the whole repository into memory when it is
+     * created. Loads and queries of preloaded shaders are then served from memory, while
+     * shaders written afterwards are read from the repository.
+     */
+    typedef struct VsmPreloadCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VkBool32 preload;
+    } VsmPreloadCreateInfo;
+
+    /**
+     * @brief VSM repository create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_REPOSITORY_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param format The format of the file at repositoryPath. VSM_REPOSITORY_FORMAT_PACK opens
+     * a read only pack written by vsmExportPack and maps it into memory, so shaders can be
+     * loaded and queried but not compiled, removed or cleared. VSM_REPOSITORY_FORMAT_MEMORY
+     * ignores repositoryPath and keeps shaders in a hash table for the life of the context.
+     */
+    typedef struct VsmRepositoryCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VsmRepositoryFormat format;
+    } VsmRepositoryCreateInfo;
+
+    /**
+     * @brief Resolves an #include directive the search paths are not consulted for
+     * @param pHeaderName The name in the directive
+     * @param pIncluderName The name of the header containing the directive, empty for the shader
+     * @param local VK_TRUE for #include "name", VK_FALSE for #include <name>
+     * @param pUserData The pointer in VsmIncludeCreateInfo
+     * @param ppData Set to the contents of the header, which must stay valid until the compile
+     * that included it returns
+     * @param pSize Set to the size of the contents in bytes
+     * @return VK_TRUE if the header was resolved, VK_FALSE to fall back to the search paths
+     */
+    typedef VkBool32 (VKAPI_PTR *PFN_vsmIncludeCallback)(const char *pHeaderName, const char *pIncluderName, VkBool32 local, void *pUserData, const char **ppData, size_t *pSize);
+
+    /**
+     * @brief VSM include create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_INCLUDE_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param includePathCount The number of elements in ppIncludePaths
+     * @param ppIncludePaths Directories searched in order for included headers, after the
+     * directory of the including header for #include "name". Headers read from them are kept in
+     * memory and read again only when their modification time or size changes.
+     * @param pfnInclude NULL or a callback asked to resolve each include before the search paths
+     * @param pUserData Passed to pfnInclude
+     */
+    typedef struct VsmIncludeCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        uint32_t includePathCount;
+        const char *const *ppIncludePaths;
+        PFN_vsmIncludeCallback pfnInclude;
+        void *pUserData;
+    } VsmIncludeCreateInfo;
+
+    /**
+     * @brief Called on the compiling thread after each optimizer pass, when timing is requested
+     * @param pShaderName The name of the shader being optimized
+     * @param pPassName The spirv-opt flag of the pass
+     * @param nanoseconds The time the pass took
+     * @param pUserData The pointer in VsmOptimizationInfo
+     */
+    typedef void (VKAPI_PTR *PFN_vsmPassTimingCallback)(const char *pShaderName, const char *pPassName, uint64_t nanoseconds, void *pUserData);
+
+    /**
+     * @brief VSM optimization info, chained to VsmContextCreateInfo to set the default of every
+     * compile, or to VsmShaderCompileInfo to override it for one shader
+     * @param sType VSM_STRUCTURE_TYPE_OPTIMIZATION_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param level Which SPIRV-Tools passes run over the compiled code before it is stored.
+     * VSM_OPTIMIZATION_PERFORMANCE and VSM_OPTIMIZATION_SIZE run the passes of spirv-opt -O and
+     * -Os, VSM_OPTIMIZATION_CUSTOM runs ppPasses.
+     * @param passCount The number of elements in ppPasses
+     * @param ppPasses spirv-opt flags such as "--merge-blocks", run in order
+     * @param pfnTiming NULL or a callback given the time of each pass. Passes then run one at a
+     * time, which is slower than running them together.
+     * @param pUserData Passed to pfnTiming
+     * @param tiered Whether the code glslang produced is stored at once and usable right away,
+     * while a worker thread optimizes it and swaps the optimized code in. The swap is skipped if
+     * the shader was written again in the meantime, and bumps its generation.
+     */
+    typedef struct VsmOptimizationInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VsmOptimizationLevel level;
+        uint32_t passCount;
+        const char *const *ppPasses;
+        PFN_vsmPassTimingCallback pfnTiming;
+        void *pUserData;
+        VkBool32 tiered;
+    } VsmOptimizationInfo;
+
+    /**
+     * @brief VSM debug info create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_DEBUG_INFO_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param loadDebugInfo Whether code loaded by this context keeps its debug instructions, such
+     * as OpName, OpLine and OpSource, for capture tools. Debug instructions are always stored
+     * apart from the code, and by default loads and exported packs leave them out.
+     */
+    typedef struct VsmDebugInfoCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VkBool32 loadDebugInfo;
+    } VsmDebugInfoCreateInfo;
+
+    /**
+     * @brief VSM module cache create info, chained to VsmContextCreateInfo
+     * @param sType VSM_STRUCTURE_TYPE_MODULE_CACHE_CREATE_INFO
+     * @param pNext NULL or a pointer to a VSM extension structure
+     * @param shareModules Whether vsmCreateShaderModule hands out one reference counted module
+     * per device and shader, until the shader is written again. Shared modules are released with
+     * vsmReleaseShaderModule, and the context must be destroyed before their devices.
+     */
+    typedef struct VsmModuleCacheCreateInfo
+    {
+        VsmStructureType sType;
+        const void *pNext;
+        VkBool32 shareModules;
+    } VsmModuleCacheCreateInfo;
+
+    /**
+     * @brief VSM cache statistics
+     * @param hits The number of loads served from the cache
+     * @param misses The number of loads that went to the repository
+     * @param evictions The number of shaders evicted to stay within the cache size
+     * @param entryCount The number of shaders currently cached
+     * @param size The number of bytes of code currently cached
+     */
+    typedef struct VsmCacheStatistics
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint32_t entryCount;
+        size_t size;
+    } VsmCacheStatistics;
+
+    /**
+     * @brief VSM shader define, a macro defined before the source is compiled
+     * @param name The name of the macro
+     * @param value NULL or the value of the macro
+     */
+    typedef struct VsmShaderDefine
+    {
+        const char *name;
+        const char *value;
+    } VsmShaderDefine;
+
     /**
      * @brief VSM shader compile info
      * @param shaderName The name used to identify compiled shader
      * @param shaderSource The GLSL source code to compile
      * @param shaderStage The stage where shader will be used
+     * @param defineCount The number of elements in pDefines
+     * @param pDefines Macros defined in order before the source, as by #define name value
+     * @param pNext NULL or a pointer to a VSM extension structure
      */
     typedef struct VsmShaderCompileInfo
     {
         const char *shaderName;
         const char *shaderSource;
         VsmShaderStage shaderStage;
+        uint32_t defineCount;
+        const VsmShaderDefine *pDefines;
+        const void *pNext;
     } VsmShaderCompileInfo;
 
+    /**
+     * @brief VSM shader permutation axis, one macro and the values it takes across variants
+     * @param defineName The name of the macro
+     * @param valueCount The number of elements in ppValues
+     * @param ppValues The values of the macro, NULL leaving it undefined in that variant
+     */
+    typedef struct VsmShaderPermutationAxis
+    {
+        const char *defineName;
+        uint32_t valueCount;
+        const char *const *ppValues;
+    } VsmShaderPermutationAxis;
+
+    /**
+     * @brief VSM shader permutation info
+     * @param pCompileInfo The shader every variant is compiled from, with defines common to all
+     * @param axisCount The number of elements in pAxes
+     * @param pAxes The axes of the matrix, one variant being compiled for every combination of
+     * their values. Variants are ordered with the last axis varying fastest, and are named
+     * shaderName followed by ",NAME=value" for each axis that defines its macro.
+     */
+    typedef struct VsmShaderPermutationInfo
+    {
+        const VsmShaderCompileInfo *pCompileInfo;
+        uint32_t axisCount;
+        const VsmShaderPermutationAxis *pAxes;
+    } VsmShaderPermutationInfo;
+
+    /**
+     * @brief A descriptor a shader uses
+     * @param set The descriptor set
+     * @param binding The binding within the set
+     * @param descriptorType The type of descriptor
+     * @param descriptorCount The number of descriptors in an array binding, zero for a runtime
+     * sized array
+     */
+    typedef struct VsmShaderBinding
+    {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType descriptorType;
+        uint32_t descriptorCount;
+    } VsmShaderBinding;
+
+    /**
+     * @brief A stage input or output with a location
+     * @param location The first location of the variable
+     * @param format The format of one location, VK_FORMAT_UNDEFINED for types without one
+     */
+    typedef struct VsmShaderInterfaceVariable
+    {
+        uint32_t location;
+        VkFormat format;
+    } VsmShaderInterfaceVariable;
+
+    /**
+     * @brief Reflection data recorded when a shader is compiled
+     * @param localSize The workgroup size of a compute shader, 1 in each dimension otherwise
+     * @param pushConstantOffset The offset of the push constant block's first member
+     * @param pushConstantSize The size of the push constant range, 0 without push constants
+     * @param bindingCount The capacity of pBindings, set to the number of bindings written
+     * @param pBindings NULL to get bindingCount, or the array receiving the bindings ordered by
+     * set and binding
+     * @param inputCount The capacity of pInputs, set to the number of inputs written
+     * @param pInputs NULL to get inputCount, or the array receiving the inputs ordered by location
+     * @param outputCount The capacity of pOutputs, set to the number of outputs written
+     * @param pOutputs NULL to get outputCount, or the array receiving the outputs ordered by
+     * location
+     */
+    typedef struct VsmShaderReflection
+    {
+        uint32_t localSize[3];
+        uint32_t pushConstantOffset;
+        uint32_t pushConstantSize;
+        uint32_t bindingCount;
+        VsmShaderBinding *pBindings;
+        uint32_t inputCount;
+        VsmShaderInterfaceVariable *pInputs;
+        uint32_t outputCount;
+        VsmShaderInterfaceVariable *pOutputs;
+    } VsmShaderReflection;
+
     /**
      * @brief VSM shader module create info
      * @param device The Vulkan logical device used to creates the shader module
@@ -158,20 +495,276 @@ extern "C"
 
     VK_DEFINE_HANDLE(VsmContext);
 
+    VK_DEFINE_HANDLE(VsmShader);
+
+    VK_DEFINE_HANDLE(VsmJob);
+
+    /**
+     * @brief Called on a worker thread when an asynchronous compile finishes
+     * @param job The job that finished, valid until the callback returns if it was not kept
+     * @param result The result vsmCompileShader would have returned
+     * @param pUserData The pointer passed to vsmCompileShaderAsync
+     */
+    typedef void (VKAPI_PTR *PFN_vsmCompileCallback)(VsmJob job, VsmResult result, void *pUserData);
+
+    /**
+     * @brief VSM shader module create info, identifying the shader by handle
+     * @param device The Vulkan logical device used to creates the shader module
+     * @param shader The handle of the shader to create the module from
+     * @param pNext Should be NULL
+     * @param flags Reserved for future use
+     */
+    typedef struct VsmShaderModuleHandleCreateInfo
+    {
+        VkDevice device;
+        VsmShader shader;
+        void *pNext;
+        VkShaderModuleCreateFlags flags;
+    } VsmShaderModuleHandleCreateInfo;
+
     VSM_API_CALL VsmResult vsmCreateContext(const VsmContextCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VsmContext *pContext);
 
     VSM_API_CALL void vsmDestroyContext(VsmContext context, const VkAllocationCallbacks *pAllocator);
 
+    /**
+     * @brief Compile a shader and store it, unless it is stored unchanged. Any number of threads
+     * may compile at once, on the same or different contexts, as glslang is initialized for the
+     * process while any context exists.
+     * @param context The context used to compile and store the shader
+     * @param pCompileInfo The shader to compile
+     */
     VSM_API_CALL VsmResult vsmCompileShader(VsmContext context, const VsmShaderCompileInfo *pCompileInfo);
 
+    /**
+     * @brief Compile several shaders in parallel and store them in one transaction
+     * @param context The context used to compile and store the shaders
+     * @param compileInfoCount The number of elements in pCompileInfos
+     * @param pCompileInfos The shaders to compile
+     * @param pResults Optional array of compileInfoCount results, one per shader
+     * @return VSM_SUCCESS if every shader was stored, otherwise the first failing result
+     */
+    VSM_API_CALL VsmResult vsmCompileShaders(VsmContext context, uint32_t compileInfoCount, const VsmShaderCompileInfo *pCompileInfos, VsmResult *pResults);
+
+    /**
+     * @brief Compile every variant of a permutation matrix in parallel and store them in one
+     * transaction. Variants that compile to the same code share one stored copy of it.
+     * @param context The context used to compile and store the variants
+     * @param pPermutationInfo The shader and the axes of its permutation matrix
+     * @param pVariantCount Optional count of variants, the product of the axes' value counts
+     * @param pResults Optional array of results, one per variant in variant order
+     * @return VSM_SUCCESS if every variant was stored, otherwise the first failing result
+     */
+    VSM_API_CALL VsmResult vsmCompilePermutations(VsmContext context, const VsmShaderPermutationInfo *pPermutationInfo, uint32_t *pVariantCount, VsmResult *pResults);
+
+    /**
+     * @brief Recompile in parallel every shader with an included header whose contents changed
+     * since it was compiled, directly or through another header, and store them in one
+     * transaction. Headers are checked by the name they resolved to, so a header resolved by the
+     * include callback is asked for again with an empty includer name.
+     * @param context The context used to compile and store the shaders
+     * @param pRebuiltCount Optional count of stale shaders that were recompiled and stored
+     * @return VSM_SUCCESS if every stale shader was stored, otherwise the first failing result,
+     * or VSM_ERROR_REPOSITORY_LOAD if a stale shader has no recorded source to rebuild from
+     */
+    VSM_API_CALL VsmResult vsmRebuildStale(VsmContext context, uint32_t *pRebuiltCount);
+
     VSM_API_CALL VsmResult vsmQueryShader(VsmContext context, const char *shaderName, VkBool32 *pFound, VsmShaderStage *pShaderStage);
 
     VSM_API_CALL VsmResult vsmRemoveShader(VsmContext context, const char *shaderName);
 
+    /**
+     * @brief Get the generation of a stored shader, which changes whenever its code is written,
+     * including when tiered optimization swaps in optimized code
+     * @param context The context whose repository holds the shader
+     * @param shaderName The name of the shader
+     * @param pGeneration Set to the shader's generation
+     */
+    VSM_API_CALL VsmResult vsmGetShaderGeneration(VsmContext context, const char *shaderName, uint64_t *pGeneration);
+
     VSM_API_CALL VsmResult vsmClearShaders(VsmContext context);
 
+    /**
+     * @brief Get the reflection data recorded when a shader was compiled, without parsing its
+     * code. Arrays are filled the way Vulkan fills them: called with NULL arrays it sets the
+     * counts, and called with arrays it fills up to the given counts.
+     * @param context The context whose repository holds the shader
+     * @param shaderName The name of the shader
+     * @param pReflection Receives the reflection data
+     * @return VSM_INCOMPLETE if an array was too small for all of its elements, or
+     * VSM_ERROR_REPOSITORY_QUERY for a shader stored without reflection data, as shaders stored
+     * by older versions are
+     */
+    VSM_API_CALL VsmResult vsmGetShaderReflection(VsmContext context, const char *shaderName, VsmShaderReflection *pReflection);
+
     VSM_API_CALL VsmResult vsmCreateShaderModule(VsmContext context, const VsmShaderModuleCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModule);
 
+    /**
+     * @brief Create several shader modules, like vsmCreateShaderModule, reading the shaders in
+     * one repository pass and creating the modules in parallel
+     * @param context The context whose repository holds the shaders
+     * @param createInfoCount The number of elements in pCreateInfos
+     * @param pCreateInfos The device and shader of each module
+     * @param pAllocator Passed to vkCreateShaderModule
+     * @param pShaderModules Receives createInfoCount modules, VK_NULL_HANDLE for those that failed
+     * @param pResults Optional array of createInfoCount results, one per module
+     * @return VSM_SUCCESS if every module was created, otherwise the first failing result
+     */
+    VSM_API_CALL VsmResult vsmCreateShaderModules(VsmContext context, uint32_t createInfoCount, const VsmShaderModuleCreateInfo *pCreateInfos, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModules, VsmResult *pResults);
+
+    /**
+     * @brief Release a module created by vsmCreateShaderModule, vsmCreateShaderModules or
+     * vsmCreateShaderModuleFromHandle. A shared module is destroyed when its last reference is
+     * released, any other module right away.
+     * @param context The context that created the module
+     * @param device The device the module was created on
+     * @param shaderModule The module to release
+     * @param pAllocator Passed to vkDestroyShaderModule for modules that are not shared, which
+     * are destroyed with the allocator they were created with
+     */
+    VSM_API_CALL VsmResult vsmReleaseShaderModule(VsmContext context, VkDevice device, VkShaderModule shaderModule, const VkAllocationCallbacks *pAllocator);
+
+    /**
+     * @brief Fill in a pipeline stage that carries its code inline, for devices with
+     * VK_KHR_maintenance5 enabled, so no shader module is created. The module create info is
+     * chained to the stage, and its code stays valid until the stage is released with
+     * vsmReleasePipelineShaderStageCreateInfo or the context is destroyed, even if the shader
+     * is written again in the meantime. vsmCreateShaderModule remains the path for other devices.
+     * @param context The context whose repository holds the shader
+     * @param shaderName The name of the shader
+     * @param pStageCreateInfo Receives the stage, with the shader's stage and the entry point main
+     * @param pModuleCreateInfo Receives the code, chained to pStageCreateInfo, so it must live as
+     * long as the stage is used
+     */
+    VSM_API_CALL VsmResult vsmGetPipelineShaderStageCreateInfo(VsmContext context, const char *shaderName, VkPipelineShaderStageCreateInfo *pStageCreateInfo, VkShaderModuleCreateInfo *pModuleCreateInfo);
+
+    /**
+     * @brief Release the code of a stage filled in by vsmGetPipelineShaderStageCreateInfo, once
+     * every pipeline created from it exists. Releasing code the context did not hand out does nothing.
+     * @param context The context that filled in the stage
+     * @param pStageCreateInfo The stage, which must still have its module create info chained
+     */
+    VSM_API_CALL VsmResult vsmReleasePipelineShaderStageCreateInfo(VsmContext context, const VkPipelineShaderStageCreateInfo *pStageCreateInfo);
+
+    /**
+     * @brief Store pipeline cache data, as returned by vkGetPipelineCacheData, for the device
+     * and driver named in its header. The data replaces what is stored for that device, so the
+     * last store wins, while data for other devices is kept. Data that is already stored is not
+     * written again. Use vsmMergePipelineCache to keep what other caches stored.
+     * @param context The context whose repository keeps the data
+     * @param dataSize The size of the data in bytes
+     * @param pData The pipeline cache data
+     * @return VSM_ERROR_PIPELINE_CACHE if the data does not start with a valid version one
+     * header, or VSM_ERROR_REPOSITORY_STORE for a pack repository
+     */
+    VSM_API_CALL VsmResult vsmStorePipelineCache(VsmContext context, size_t dataSize, const void *pData);
+
+    /**
+     * @brief Merge a pipeline cache into the data stored for its device with
+     * vkMergePipelineCaches, so caches filled by different runs or threads add up instead of
+     * replacing each other. Without stored data the cache's own data is stored.
+     * @param context The context whose repository keeps the data
+     * @param device The device that owns the cache
+     * @param pipelineCache The cache to merge, which is left unchanged
+     * @param pAllocator Passed to vkCreatePipelineCache and vkDestroyPipelineCache for the
+     * temporary cache the stored data is merged in
+     * @return VSM_ERROR_PIPELINE_CACHE if the driver fails or its data has no valid version one
+     * header, or VSM_ERROR_REPOSITORY_STORE for a pack repository
+     */
+    VSM_API_CALL VsmResult vsmMergePipelineCache(VsmContext context, VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks *pAllocator);
+
+    /**
+     * @brief Load the pipeline cache data stored for a device, to create its VkPipelineCache
+     * from. Called with NULL data it sets the size, and called with data it copies the whole of
+     * it, as partial pipeline cache data is of no use.
+     * @param context The context whose repository keeps the data
+     * @param pProperties The properties of the device, whose vendorID, deviceID and
+     * pipelineCacheUUID select the data
+     * @param pDataSize Set to the size of the data, 0 if nothing is stored for the device
+     * @param pData NULL, or where to copy the data to
+     * @return VSM_INCOMPLETE, having copied nothing, if pDataSize is smaller than the data
+     */
+    VSM_API_CALL VsmResult vsmLoadPipelineCache(VsmContext context, const VkPhysicalDeviceProperties *pProperties, size_t *pDataSize, void *pData);
+
+    /**
+     * @brief Get the hit and miss counters of the context's code cache
+     * @param context The context that owns the cache
+     * @param pStatistics Receives the current counters
+     */
+    VSM_API_CALL VsmResult vsmGetCacheStatistics(VsmContext context, VsmCacheStatistics *pStatistics);
+
+    /**
+     * @brief Compile and store a shader on the context's worker threads, returning immediately
+     * @param context The context used to compile and store the shader
+     * @param pCompileInfo The shader to compile, copied before the call returns
+     * @param pfnCallback NULL or a function called when the job finishes
+     * @param pUserData Passed to pfnCallback
+     * @param pJob NULL, or receives a job to poll, wait for and destroy. Without it the job
+     * is destroyed once it finishes.
+     */
+    VSM_API_CALL VsmResult vsmCompileShaderAsync(VsmContext context, const VsmShaderCompileInfo *pCompileInfo, PFN_vsmCompileCallback pfnCallback, void *pUserData, VsmJob *pJob);
+
+    /**
+     * @brief Get the result of a job without waiting for it
+     * @param context The context that owns the job
+     * @param job The job to poll
+     * @return VSM_NOT_READY while the job runs, then the result of the compile
+     */
+    VSM_API_CALL VsmResult vsmPollJob(VsmContext context, VsmJob job);
+
+    /**
+     * @brief Wait until every job has finished and its callback has returned
+     * @param context The context that owns the jobs
+     * @param jobCount The number of elements in pJobs
+     * @param pJobs The jobs to wait for
+     * @return VSM_SUCCESS, or the result of the first job that failed
+     */
+    VSM_API_CALL VsmResult vsmWaitForJobs(VsmContext context, uint32_t jobCount, const VsmJob *pJobs);
+
+    /**
+     * @brief Destroy a job, waiting for it to finish first. Jobs that are not destroyed are
+     * destroyed with their context, after they finish.
+     * @param context The context that owns the job
+     * @param job The job to destroy
+     */
+    VSM_API_CALL VsmResult vsmDestroyJob(VsmContext context, VsmJob job);
+
+    /**
+     * @brief Write every shader in the repository, with its reflection data, to a read only pack
+     * file
+     * @param context The context whose repository is exported
+     * @param packPath The path of the pack file, which is replaced if it exists
+     */
+    VSM_API_CALL VsmResult vsmExportPack(VsmContext context, const char *packPath);
+
+    /**
+     * @brief Resolve a shader name to a handle, which stays valid until the context is destroyed
+     * @param context The context that owns the handle
+     * @param shaderName The name of the shader, which does not need to be stored yet
+     * @param pShader Receives the handle, the same one for every call with the same name
+     */
+    VSM_API_CALL VsmResult vsmGetShaderHandle(VsmContext context, const char *shaderName, VsmShader *pShader);
+
+    /**
+     * @brief Query a shader by handle, like vsmQueryShader
+     * @param context The context that owns the handle
+     * @param shader The handle of the shader to query
+     * @param pFound Receives whether the shader is stored
+     * @param pShaderStage Receives the stage of the shader
+     */
+    VSM_API_CALL VsmResult vsmQueryShaderHandle(VsmContext context, VsmShader shader, VkBool32 *pFound, VsmShaderStage *pShaderStage);
+
+    /**
+     * @brief Create a shader module by handle, like vsmCreateShaderModule. The handle keeps
+     * the code it last read, so repeated calls do not touch the repository until the shader
+     * is written again. The module is shared like those of vsmCreateShaderModule and must be
+     * released with vsmReleaseShaderModule.
+     * @param context The context that owns the handle
+     * @param pCreateInfo The device and handle to create the module from
+     * @param pAllocator Passed to vkCreateShaderModule
+     * @param pShaderModule Receives the shader module
+     */
+    VSM_API_CALL VsmResult vsmCreateShaderModuleFromHandle(VsmContext context, const VsmShaderModuleHandleCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkShaderModule *pShaderModule);
+
 #ifdef __cplusplus
 }
 #endif